@@ -0,0 +1,693 @@
+#pragma once
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <bitset>
+#include <cstddef>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <semaphore>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "event_log.hpp"
+#include "futex.hpp"
+#include "indexed_heap.hpp"
+#include "metrics.hpp"
+#include "ring_buffer.hpp"
+#include "station.hpp"
+#include "trace.hpp"
+
+template <typename T>
+class SharedMemory
+{
+ public:
+  SharedMemory() : SharedMemory(sizeof(T)) {}
+
+  template <typename... Args>
+  explicit SharedMemory(std::size_t size, Args&&... args)
+      : identity { shmget(IPC_PRIVATE, size, IPC_CREAT | 0666) },
+        object { new (shmat(identity, nullptr, 0))
+                     T { std::forward<Args>(args)... } }
+  {
+  }
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  ~SharedMemory()
+  {
+    shmdt(object);
+    shmctl(identity, IPC_RMID, nullptr);
+  }
+
+  [[nodiscard]] T* operator->() const { return object; }
+
+  [[nodiscard]] T& operator*() const { return *object; }
+
+ private:
+  int identity {};
+
+  T* object {};
+};
+
+// Аналог SharedMemory для одного процесса: тот же размер с хвостом полос и
+// то же выравнивание, но обычная куча.
+template <typename T>
+class LocalMemory
+{
+ public:
+  template <typename... Args>
+  explicit LocalMemory(std::size_t size, Args&&... args)
+      : object { new (::operator new(size, std::align_val_t { alignof(T) }))
+                     T { std::forward<Args>(args)... } }
+  {
+  }
+
+  LocalMemory(const LocalMemory&) = delete;
+  LocalMemory& operator=(const LocalMemory&) = delete;
+
+  ~LocalMemory()
+  {
+    object->~T();
+    ::operator delete(object, std::align_val_t { alignof(T) });
+  }
+
+  [[nodiscard]] T* operator->() const { return object; }
+
+  [[nodiscard]] T& operator*() const { return *object; }
+
+ private:
+  T* object {};
+};
+
+// Очередь станции. В простом режиме (FIFO, без терпения, колонка на один вид
+// топлива) полоса топлива — кольцо без блокировок со своим семафором. Иначе
+// машины лежат в пуле, полоса — куча номеров ячеек по ключу политики, а сроки
+// терпения — в общей куче; все это меняется под одним замком за O(log n), и
+// каждая колонка ждет на своем семафоре, пока прибывшая машина ее не разбудит.
+template <typename Semaphore, typename Mutex>
+struct alignas(cache_line) BasicQueue
+{
+  static constexpr auto max_size { 15 };
+
+  static constexpr auto capacity { std::bit_ceil<std::size_t>(max_size) };
+
+  using Heap = IndexedHeap<capacity>;
+
+  using Slot = Heap::Slot;
+
+  struct alignas(cache_line) Lane
+  {
+    RingBuffer<Car, capacity> cars {};
+
+    alignas(cache_line) Semaphore semaphore {};
+
+    Heap waiting {};
+
+    LaneMetrics metrics {};
+  };
+
+  // Колонка в режиме политик: виды топлива и семафор, на котором она ждет,
+  // если совместимых машин нет (idle)
+  struct alignas(cache_line) Stand
+  {
+    Semaphore semaphore {};
+
+    std::bitset<Record::max_fuels> fuels {};
+
+    bool idle {};
+  };
+
+  struct Entry
+  {
+    Car car {};
+
+    double priority {};
+
+    std::uint64_t sequence {};
+  };
+
+  BasicQueue(std::size_t fuels, std::span<const Column> columns,
+             Dispatch dispatch)
+      : fuels { fuels },
+        columns { columns.size() },
+        dispatch { dispatch },
+        indexed { dispatch != Dispatch::fifo || Generator::mean_patience > 0 ||
+                  std::ranges::any_of(columns, [](const Column& column) {
+                    return column.fuels.size() > 1;
+                  }) }
+  {
+    std::uninitialized_value_construct_n(lanes(), fuels);
+    std::uninitialized_value_construct_n(column_metrics(), this->columns);
+    std::uninitialized_value_construct_n(stands(), this->columns);
+
+    for (std::size_t index {}; index < this->columns; ++index)
+      for (const auto& fuel : columns[index].fuels)
+        stands()[index].fuels.set(fuel.index);
+
+    for (std::size_t slot {}; slot < capacity; ++slot)
+      free_slots[slot] = static_cast<Slot>(slot);
+  }
+
+  BasicQueue(const BasicQueue&) = delete;
+  BasicQueue& operator=(const BasicQueue&) = delete;
+
+  ~BasicQueue()
+  {
+    std::destroy_n(stands(), columns);
+    std::destroy_n(column_metrics(), columns);
+    std::destroy_n(lanes(), fuels);
+  }
+
+  // Полосы по видам топлива, счетчики и места колонок лежат в том же
+  // сегменте сразу за очередью
+  [[nodiscard]] static std::size_t size(std::size_t fuels, std::size_t columns)
+  {
+    return sizeof(BasicQueue) + fuels * sizeof(Lane) +
+           columns * (sizeof(ColumnMetrics) + sizeof(Stand));
+  }
+
+  [[nodiscard]] Lane* lanes()
+  {
+    return std::launder(reinterpret_cast<Lane*>(this + 1));
+  }
+
+  [[nodiscard]] ColumnMetrics* column_metrics()
+  {
+    return std::launder(reinterpret_cast<ColumnMetrics*>(lanes() + fuels));
+  }
+
+  [[nodiscard]] Stand* stands()
+  {
+    return std::launder(reinterpret_cast<Stand*>(column_metrics() + columns));
+  }
+
+  [[nodiscard]] Lane& lane(const Fuel& fuel) { return lanes()[fuel.index]; }
+
+  // Машин, взятых на обслуживание всеми колонками
+  [[nodiscard]] std::uint64_t served()
+  {
+    std::uint64_t total {};
+
+    for (std::size_t index {}; index < columns; ++index)
+      total += column_metrics()[index].served.load(std::memory_order_relaxed);
+
+    return total;
+  }
+
+  [[nodiscard]] std::optional<Car> find_nearest_car(const Fuel& fuel)
+  {
+    auto result { lane(fuel).cars.try_pop() };
+
+    if (result) current_size.fetch_sub(1, std::memory_order_release);
+
+    return result;
+  }
+
+  [[nodiscard]] bool reserve()
+  {
+    auto size { current_size.load(std::memory_order_relaxed) };
+
+    while (size < max_size)
+      if (current_size.compare_exchange_weak(size, size + 1,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed))
+        return true;
+
+    return false;
+  }
+
+  [[nodiscard]] bool insert_car(const Car& car)
+  {
+    if (indexed) return insert_indexed(car);
+
+    auto& target { lane(car.fuel) };
+
+    if (!reserve())
+    {
+      target.metrics.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    // Место зарезервировано счетчиком, поэтому кольцо полосы не переполнится
+    [[maybe_unused]] auto const pushed { target.cars.try_push(car) };
+    target.metrics.inserted.fetch_add(1, std::memory_order_relaxed);
+    target.semaphore.post();
+
+    metrics.observe_depth(current_size.load(std::memory_order_relaxed));
+
+    return true;
+  }
+
+  // Лучшая по ключу политики машина из полос колонки column; при FIFO — та,
+  // что дольше всех ждет среди совместимых. Пустой результат переводит
+  // колонку в ожидание, если очередь не закрыта.
+  [[nodiscard]] std::optional<Car> pick(std::size_t column)
+  {
+    const std::scoped_lock lock { mutex };
+
+    expire(std::chrono::system_clock::now());
+
+    auto& stand { stands()[column] };
+    Lane* best {};
+
+    for (std::size_t fuel {}; fuel < fuels; ++fuel)
+    {
+      auto& candidate { lanes()[fuel] };
+
+      if (!stand.fuels.test(fuel) || candidate.waiting.empty()) continue;
+
+      if (!best || by_priority(candidate.waiting.top(), best->waiting.top()))
+        best = &candidate;
+    }
+
+    if (!best)
+    {
+      stand.idle = !finished.load(std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    const auto slot { best->waiting.top() };
+    const auto car { entries[slot].car };
+
+    remove(slot);
+
+    return car;
+  }
+
+  // Вызывается после последней вставки. В простом режиме будит каждую
+  // колонку меткой закрытия в ее полосе, сверх уже выданных постов за
+  // машины; в режиме политик — все ждущие колонки.
+  void close(std::span<const Column> columns)
+  {
+    if (!indexed)
+    {
+      finished.store(true, std::memory_order_release);
+
+      for (const auto& column : columns) lane(column.fuel).semaphore.post();
+
+      return;
+    }
+
+    const std::scoped_lock lock { mutex };
+
+    finished.store(true, std::memory_order_release);
+
+    for (std::size_t index {}; index < this->columns; ++index)
+      if (std::exchange(stands()[index].idle, false))
+        stands()[index].semaphore.post();
+  }
+
+  std::size_t fuels {};
+
+  std::size_t columns {};
+
+  Dispatch dispatch {};
+
+  bool indexed {};
+
+  StationMetrics metrics {};
+
+  alignas(cache_line) std::atomic<int> current_size {};
+
+  std::atomic_bool finished { false };
+
+ private:
+  [[nodiscard]] double priority(const Car& car) const
+  {
+    if (dispatch == Dispatch::shortest_service) return car.demand;
+
+    if (dispatch == Dispatch::earliest_deadline)
+      return std::chrono::duration<double>(car.deadline.time_since_epoch())
+          .count();
+
+    return 0;
+  }
+
+  [[nodiscard]] bool by_priority(Slot first, Slot second) const
+  {
+    return std::pair { entries[first].priority, entries[first].sequence } <
+           std::pair { entries[second].priority, entries[second].sequence };
+  }
+
+  [[nodiscard]] bool by_deadline(Slot first, Slot second) const
+  {
+    return entries[first].car.deadline < entries[second].car.deadline;
+  }
+
+  [[nodiscard]] auto priority_order() const
+  {
+    return [this](Slot first, Slot second) {
+      return by_priority(first, second);
+    };
+  }
+
+  [[nodiscard]] auto deadline_order() const
+  {
+    return [this](Slot first, Slot second) {
+      return by_deadline(first, second);
+    };
+  }
+
+  [[nodiscard]] bool insert_indexed(const Car& car)
+  {
+    const std::scoped_lock lock { mutex };
+
+    expire(car.timestamp);
+
+    auto& target { lane(car.fuel) };
+
+    if (depth >= max_size)
+    {
+      target.metrics.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    const auto slot { free_slots[--free_count] };
+    entries[slot] = { .car = car,
+                      .priority = priority(car),
+                      .sequence = sequence++ };
+
+    target.waiting.push(slot, priority_order());
+
+    if (car.deadline != time_point::max())
+      deadlines.push(slot, deadline_order());
+
+    current_size.store(++depth, std::memory_order_relaxed);
+    target.metrics.inserted.fetch_add(1, std::memory_order_relaxed);
+    metrics.observe_depth(depth);
+
+    for (std::size_t index {}; index < columns; ++index)
+    {
+      auto& stand { stands()[index] };
+
+      if (stand.idle && stand.fuels.test(car.fuel.index))
+      {
+        stand.idle = false;
+        stand.semaphore.post();
+        break;
+      }
+    }
+
+    return true;
+  }
+
+  // Машины, чье терпение кончилось к now, уходят из очереди
+  void expire(time_point now)
+  {
+    while (!deadlines.empty() &&
+           entries[deadlines.top()].car.deadline <= now)
+    {
+      const auto slot { deadlines.top() };
+
+      lane(entries[slot].car.fuel)
+          .metrics.reneged.fetch_add(1, std::memory_order_relaxed);
+      remove(slot);
+    }
+  }
+
+  void remove(Slot slot)
+  {
+    const auto& car { entries[slot].car };
+
+    lane(car.fuel).waiting.erase(slot, priority_order());
+
+    if (car.deadline != time_point::max())
+      deadlines.erase(slot, deadline_order());
+
+    free_slots[free_count++] = slot;
+    current_size.store(--depth, std::memory_order_relaxed);
+  }
+
+  Mutex mutex {};
+
+  std::array<Entry, capacity> entries {};
+
+  std::array<Slot, capacity> free_slots {};
+
+  std::size_t free_count { capacity };
+
+  Heap deadlines {};
+
+  int depth {};
+
+  std::uint64_t sequence {};
+};
+
+// Тот же интерфейс, что у FutexSemaphore, для очереди внутри одного процесса
+class LocalSemaphore
+{
+ public:
+  void post(std::ptrdiff_t count = 1) { semaphore.release(count); }
+
+  void wait() { semaphore.acquire(); }
+
+  [[nodiscard]] bool try_wait() { return semaphore.try_acquire(); }
+
+ private:
+  std::counting_semaphore<> semaphore { 0 };
+};
+
+using SharedQueue = BasicQueue<FutexSemaphore, FutexMutex>;
+
+using LocalQueue = BasicQueue<LocalSemaphore, std::mutex>;
+
+// Неотрицательная нормальная величина; нулевое отклонение дает ровно mean
+inline double draw(double mean, double standard_deviation,
+                     std::mt19937& number_generator)
+{
+  if (standard_deviation <= 0) return std::max(0.0, mean);
+
+  std::normal_distribution<> distribution(mean, standard_deviation);
+  return std::max(0.0, distribution(number_generator));
+}
+
+// Нулевая пауза обходится без системного вызова: иначе нулевые времена
+// бенчмарка мерили бы запас таймера ядра, а не очередь
+inline void hold(std::chrono::duration<double> duration)
+{
+  if (duration > duration.zero()) std::this_thread::sleep_for(duration);
+}
+
+// Машина, прибывшая сейчас; объем заправки и терпение разыгрываются так же,
+// как в модели
+inline Car arriving(int id, Fuel fuel, std::mt19937& number_generator)
+{
+  const auto now { std::chrono::system_clock::now() };
+
+  const auto patience { [&] {
+    return now + std::chrono::duration_cast<time_point::duration>(
+                     std::chrono::duration<double>(
+                         draw(Generator::mean_patience,
+                              Generator::patience_deviation,
+                              number_generator)));
+  } };
+
+  return {
+    .id = id,
+    .fuel = fuel,
+    .timestamp = now,
+    .demand = draw(1, Generator::demand_deviation, number_generator),
+    .deadline =
+        Generator::mean_patience > 0 ? patience() : time_point::max(),
+  };
+}
+
+template <typename Queue>
+void Generator::generate(Queue& queue)
+{
+  std::mt19937 number_generator(std::random_device {}());
+  auto fuels { Fuels::distribution() };
+
+  EventLog log { "queue.bin" };
+
+  for (int request { 0 }; request < requests; ++request)
+  {
+    hold(std::chrono::duration<double>(
+        draw(mean_generation_time, standard_deviation, number_generator)));
+
+    const auto car { arriving(request, { fuels(number_generator) },
+                              number_generator) };
+
+    log.push(Record::of(queue.insert_car(car) ? Record::Kind::inserted
+                                              : Record::Kind::dropped,
+                        car));
+  }
+}
+
+template <typename Queue>
+void Generator::replay(Queue& queue, const Trace& trace)
+{
+  std::mt19937 number_generator(std::random_device {}());
+
+  EventLog log { "queue.bin" };
+
+  const auto start { std::chrono::steady_clock::now() };
+  auto cursor { trace.begin() };
+
+  for (int request { 0 }; const auto arrival { cursor.next() }; ++request)
+  {
+    std::this_thread::sleep_until(
+        start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(arrival->time)));
+
+    const auto car { arriving(request, arrival->fuel, number_generator) };
+
+    log.push(Record::of(queue.insert_car(car) ? Record::Kind::inserted
+                                              : Record::Kind::dropped,
+                        car));
+  }
+}
+
+template <typename Queue>
+void Column::serve(int index, Queue& queue) const
+{
+  std::mt19937 number_generator(std::random_device {}());
+
+  EventLog log { std::format("column_{}.bin", index) };
+
+  auto& counters { queue.column_metrics()[index - 1] };
+
+  const auto service { [&](const Car& car) {
+    using std::chrono::duration_cast, std::chrono::microseconds;
+
+    log.push(Record::of(Record::Kind::service, car, index));
+
+    queue.metrics.wait.record(duration_cast<microseconds>(
+        std::chrono::system_clock::now() - car.timestamp));
+    queue.lane(car.fuel).metrics.served.fetch_add(1, std::memory_order_relaxed);
+    counters.served.fetch_add(1, std::memory_order_relaxed);
+
+    const std::chrono::duration<double> duration {
+      draw(mean_service_time, standard_deviation, number_generator) *
+      car.demand
+    };
+    hold(duration);
+
+    queue.metrics.service.record(duration_cast<microseconds>(duration));
+    counters.busy_microseconds.fetch_add(
+        duration_cast<microseconds>(duration).count(),
+        std::memory_order_relaxed);
+  } };
+
+  // Пустой pick переводит колонку в ожидание на ее семафоре; каждый post —
+  // прибывшая совместимая машина или закрытие очереди
+  if (queue.indexed)
+  {
+    while (true)
+    {
+      if (const auto car { queue.pick(index - 1) })
+        service(*car);
+      else if (queue.finished.load(std::memory_order_acquire))
+        break;
+      else
+        queue.stands()[index - 1].semaphore.wait();
+    }
+
+    return;
+  }
+
+  // Каждый post семафора полосы — либо машина, уже лежащая в кольце, либо
+  // метка закрытия после последней вставки. Поэтому пустое кольцо после
+  // пробуждения означает, что очередь закрыта и машин этого топлива не осталось
+  while (true)
+  {
+    queue.lane(fuel).semaphore.wait();
+
+    const auto car { queue.find_nearest_car(fuel) };
+
+    if (car)
+      service(*car);
+    else if (queue.finished.load(std::memory_order_acquire))
+      break;
+  }
+}
+
+// Каждая колонка — отдельный процесс, очередь в разделяемой памяти SysV.
+// Возвращает число обслуженных машин.
+inline std::uint64_t run_processes(std::span<const Column> columns,
+                                   Dispatch dispatch = Dispatch::fifo,
+                                   const Trace* trace = nullptr)
+{
+  const SharedMemory<SharedQueue> queue {
+    SharedQueue::size(Fuels::count(), columns.size()), Fuels::count(),
+    columns, dispatch
+  };
+
+  std::vector<pid_t> pids;
+
+  // Иначе несброшенный вывод родителя повторится в каждом дочернем процессе
+  std::fflush(stdout);
+
+  for (int index {}; auto column : columns)
+  {
+    ++index;
+
+    pids.emplace_back(fork());
+    if (pids.back() != 0) continue;
+
+    column.serve(index, *queue);
+    std::exit(0);
+  }
+
+  const MetricsExporter exporter { *queue, columns };
+
+  if (trace)
+    Generator::replay(*queue, *trace);
+  else
+    Generator::generate(*queue);
+
+  queue->close(columns);
+
+  for (auto const& pid : pids) waitpid(pid, nullptr, 0);
+
+  return queue->served();
+}
+
+// Каждая колонка — поток std::jthread, очередь в памяти процесса.
+// Возвращает число обслуженных машин.
+inline std::uint64_t run_threads(std::span<const Column> columns,
+                                 Dispatch dispatch = Dispatch::fifo,
+                                 const Trace* trace = nullptr)
+{
+  const LocalMemory<LocalQueue> queue {
+    LocalQueue::size(Fuels::count(), columns.size()), Fuels::count(),
+    columns, dispatch
+  };
+
+  {
+    const MetricsExporter exporter { *queue, columns };
+
+    std::vector<std::jthread> threads;
+
+    for (int index {}; auto const& column : columns)
+      threads.emplace_back(
+          [&column, &queue, index = ++index] { column.serve(index, *queue); });
+
+    if (trace)
+      Generator::replay(*queue, *trace);
+    else
+      Generator::generate(*queue);
+
+    queue->close(columns);
+  }
+
+  return queue->served();
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <print>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "backend.hpp"
+#include "event_log.hpp"
+#include "nlohmann/json.hpp"
+#include "station.hpp"
+
+namespace
+{
+constexpr auto startup_runs { 20 };
+constexpr auto throughput_requests { 200000 };
+
+double measure(const std::function<void()>& run)
+{
+  const auto started { std::chrono::steady_clock::now() };
+  run();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       started)
+      .count();
+}
+
+void compare(std::string_view name,
+             std::uint64_t (*backend)(std::span<const Column> columns,
+                                      Dispatch dispatch, const Trace* trace),
+             std::span<const Column> columns)
+{
+  Generator::requests = 0;
+
+  double startup {};
+  for (int run {}; run < startup_runs; ++run)
+    startup += measure([&] { backend(columns, Dispatch::fifo, nullptr); });
+
+  Generator::requests = throughput_requests;
+
+  // Генератор без пауз заполняет ограниченную очередь быстрее, чем колонки
+  // ее разбирают, и большая часть заявок отбрасывается. Пропускная
+  // способность поэтому считается по обслуженным машинам.
+  std::uint64_t served {};
+  const auto elapsed { measure(
+      [&] { served = backend(columns, Dispatch::fifo, nullptr); }) };
+
+  std::println("{}: запуск и остановка {:.3f} мс, обслужено {} из {} "
+               "заявок, {:.0f} машин/с",
+               name, startup / startup_runs * 1000, served,
+               throughput_requests, static_cast<double>(served) / elapsed);
+}
+}  // namespace
+
+// Сравнивает процессный и потоковый варианты станции с нулевыми временами
+// генерации и обслуживания. Нулевая пауза не доходит до sleep_for, так что
+// измеряется стоимость запуска, очереди и журнала, а не запас таймера.
+int main(int argc, char** argv)
+{
+  if (argc != 2)
+  {
+    std::println(stderr, "Использование: {} <конфигурация>", argv[0]);
+    return 1;
+  }
+
+  nlohmann::json configuration {};
+  std::ifstream { argv[1] } >> configuration;
+
+  if (configuration.contains("fuels"))
+    Fuels::grades = configuration["fuels"].get<std::vector<FuelGrade>>();
+
+  auto columns { configuration["columns"].get<std::vector<Column>>() };
+
+  for (auto& column : columns)
+  {
+    column.mean_service_time = 0;
+    column.standard_deviation = 0;
+  }
+
+  Generator::mean_generation_time = 0;
+  Generator::standard_deviation = 0;
+
+  EventLog::console = false;
+
+  std::println("Колонок: {}, видов топлива: {}", columns.size(),
+               Fuels::count());
+
+  compare("Процессы", run_processes, columns);
+  compare("Потоки", run_threads, columns);
+}
@@ -0,0 +1,31 @@
+#include <cstdio>
+#include <print>
+#include <span>
+
+#include "event_log.hpp"
+
+int main(int argc, char** argv)
+{
+  for (auto const path : std::span(argv + 1, argv + argc))
+  {
+    const auto file { std::fopen(path, "rb") };
+
+    if (!file)
+    {
+      std::println(stderr, "Не удалось открыть файл: {}", path);
+      return 1;
+    }
+
+    if (!read_header(file))
+    {
+      std::println(stderr, "Неизвестный формат журнала: {}", path);
+      std::fclose(file);
+      return 1;
+    }
+
+    for (Record record {}; std::fread(&record, sizeof(record), 1, file) == 1;)
+      std::println("{}", record.render());
+
+    std::fclose(file);
+  }
+}
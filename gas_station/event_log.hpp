@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <print>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ring_buffer.hpp"
+#include "station.hpp"
+
+// Компактная двоичная запись события. Текст строится только при декодировании
+// (или в фоновом потоке при выводе в консоль).
+struct Record
+{
+  enum class Kind : std::uint8_t
+  {
+    inserted,
+    dropped,
+    service,
+  };
+
+  [[nodiscard]] static Record of(Kind kind, const Car& car, int column = 0)
+  {
+    return {
+      .timestamp = car.timestamp.time_since_epoch().count(),
+      .id = car.id,
+      .column = static_cast<std::int16_t>(column),
+      .kind = kind,
+      .fuel = static_cast<std::uint8_t>(car.fuel.index),
+    };
+  }
+
+  [[nodiscard]] Car car() const
+  {
+    return {
+      .id = id,
+      .fuel = { fuel },
+      .timestamp = time_point { time_point::duration { timestamp } },
+    };
+  }
+
+  [[nodiscard]] std::string render() const
+  {
+    if (kind == Kind::inserted) return inserted_message(car());
+    if (kind == Kind::dropped) return dropped_message(car());
+    return service_message(column, car());
+  }
+
+  static constexpr std::size_t max_fuels { 256 };
+
+  std::int64_t timestamp {};
+  std::int32_t id {};
+  std::int16_t column {};
+  Kind kind {};
+  std::uint8_t fuel {};
+};
+
+static_assert(sizeof(Record) == 16);
+
+// За заголовком следует каталог топлива: число видов и для каждого длина
+// имени и само имя, чтобы журнал декодировался без конфигурации.
+struct RecordHeader
+{
+  // Предел длины имени топлива: журнал читается из недоверенного файла
+  static constexpr std::uint32_t max_name { 256 };
+
+  std::array<char, 4> magic { 'G', 'S', 'E', 'L' };
+  std::uint32_t version { 2 };
+  std::uint32_t fuels {};
+};
+
+inline void write_header(std::FILE* file)
+{
+  const RecordHeader header {
+    .fuels = static_cast<std::uint32_t>(Fuels::count()),
+  };
+  std::fwrite(&header, sizeof(header), 1, file);
+
+  for (auto const& grade : Fuels::grades)
+  {
+    const auto length { static_cast<std::uint32_t>(grade.name.size()) };
+    std::fwrite(&length, sizeof(length), 1, file);
+    std::fwrite(grade.name.data(), 1, length, file);
+  }
+}
+
+[[nodiscard]] inline bool read_header(std::FILE* file)
+{
+  RecordHeader header {};
+
+  if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+      header.magic != RecordHeader {}.magic ||
+      header.version != RecordHeader {}.version ||
+      header.fuels > Record::max_fuels)
+    return false;
+
+  std::vector<FuelGrade> grades(header.fuels);
+
+  for (auto& grade : grades)
+  {
+    std::uint32_t length {};
+    if (std::fread(&length, sizeof(length), 1, file) != 1 ||
+        length > RecordHeader::max_name)
+      return false;
+
+    grade.name.resize(length);
+    if (std::fread(grade.name.data(), 1, length, file) != length) return false;
+  }
+
+  Fuels::grades = std::move(grades);
+
+  return true;
+}
+
+// Журнал одного процесса: производитель кладет запись в кольцо без
+// блокировок, фоновый поток пачками переносит записи в файл.
+class EventLog
+{
+ public:
+  explicit EventLog(const std::string& path, bool echo = console)
+      : file { open(path) }, echo { echo }
+  {
+    write_header(file);
+  }
+
+  EventLog(const EventLog&) = delete;
+  EventLog& operator=(const EventLog&) = delete;
+
+  ~EventLog()
+  {
+    writer.request_stop();
+    writer.join();
+
+    std::fclose(file);
+  }
+
+  void push(const Record& record)
+  {
+    while (!records->try_push(record)) std::this_thread::yield();
+  }
+
+  // Дублировать ли записи текстом в stdout по умолчанию
+  static inline bool console { true };
+
+ private:
+  static constexpr auto flush_interval { std::chrono::milliseconds(5) };
+
+  // Бросает до запуска фонового потока, которому нужен открытый файл
+  static std::FILE* open(const std::string& path)
+  {
+    const auto file { std::fopen(path.data(), "wb") };
+
+    if (!file) throw std::runtime_error("Cannot open event log: " + path);
+
+    return file;
+  }
+
+  void drain()
+  {
+    std::array<Record, 512> batch {};
+
+    while (true)
+    {
+      std::size_t count {};
+
+      for (; count < batch.size(); ++count)
+      {
+        const auto record { records->try_pop() };
+        if (!record) break;
+        batch[count] = *record;
+      }
+
+      if (count == 0) break;
+
+      std::fwrite(batch.data(), sizeof(Record), count, file);
+
+      if (echo)
+        for (std::size_t index {}; index < count; ++index)
+          std::println("{}", batch[index].render());
+    }
+
+    std::fflush(file);
+  }
+
+  std::unique_ptr<RingBuffer<Record, 8192>> records {
+    std::make_unique<RingBuffer<Record, 8192>>()
+  };
+
+  std::FILE* file {};
+
+  bool echo {};
+
+  std::jthread writer { [this](std::stop_token token) {
+    while (!token.stop_requested())
+    {
+      drain();
+      std::this_thread::sleep_for(flush_interval);
+    }
+
+    drain();
+  } };
+};
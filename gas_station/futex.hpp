@@ -0,0 +1,91 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+
+// Семафор на futex без FUTEX_PRIVATE_FLAG: работает между процессами,
+// если объект лежит в разделяемой памяти.
+class FutexSemaphore
+{
+ public:
+  void post(std::uint32_t count = 1)
+  {
+    value.fetch_add(count, std::memory_order_seq_cst);
+
+    if (waiters.load(std::memory_order_seq_cst) != 0) wake(count);
+  }
+
+  void wait()
+  {
+    while (!try_wait())
+    {
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+
+      if (value.load(std::memory_order_seq_cst) == 0)
+        syscall(SYS_futex, &value, FUTEX_WAIT, 0, nullptr, nullptr, 0);
+
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] bool try_wait()
+  {
+    auto current { value.load(std::memory_order_relaxed) };
+
+    while (current != 0)
+      if (value.compare_exchange_weak(current, current - 1,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed))
+        return true;
+
+    return false;
+  }
+
+ private:
+  void wake(std::uint32_t count)
+  {
+    syscall(SYS_futex, &value, FUTEX_WAKE, count, nullptr, nullptr, 0);
+  }
+
+  static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+  std::atomic<std::uint32_t> value {};
+
+  std::atomic<std::uint32_t> waiters {};
+};
+
+// Замок на futex без FUTEX_PRIVATE_FLAG, как у FutexSemaphore. Состояния:
+// 0 — свободен, 1 — занят, 2 — занят и, возможно, есть ждущие; unlock
+// делает системный вызов только в последнем случае.
+class FutexMutex
+{
+ public:
+  void lock()
+  {
+    std::uint32_t current { 0 };
+
+    if (state.compare_exchange_strong(current, 1, std::memory_order_acquire))
+      return;
+
+    if (current != 2) current = state.exchange(2, std::memory_order_acquire);
+
+    while (current != 0)
+    {
+      syscall(SYS_futex, &state, FUTEX_WAIT, 2, nullptr, nullptr, 0);
+      current = state.exchange(2, std::memory_order_acquire);
+    }
+  }
+
+  void unlock()
+  {
+    if (state.exchange(0, std::memory_order_release) == 2)
+      syscall(SYS_futex, &state, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+  }
+
+ private:
+  std::atomic<std::uint32_t> state {};
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Двоичная куча фиксированной емкости над номерами ячеек внешнего пула.
+// Куча помнит место каждой ячейки, поэтому за O(log n) удаляется не только
+// вершина, но и любая ячейка. Ключи лежат в пуле, а сравнение передается в
+// каждый вызов: указателей внутри нет, и кучу можно размещать в разделяемой
+// памяти.
+template <std::size_t Capacity>
+class IndexedHeap
+{
+  static_assert(Capacity <= UINT16_MAX);
+
+ public:
+  using Slot = std::uint16_t;
+
+  [[nodiscard]] bool empty() const { return count == 0; }
+
+  [[nodiscard]] Slot top() const { return heap[0]; }
+
+  template <typename Less>
+  void push(Slot slot, Less less)
+  {
+    place(count, slot);
+    up(count++, less);
+  }
+
+  template <typename Less>
+  void erase(Slot slot, Less less)
+  {
+    const std::size_t index { position[slot] };
+
+    if (index == --count) return;
+
+    place(index, heap[count]);
+    down(up(index, less), less);
+  }
+
+ private:
+  void place(std::size_t index, Slot slot)
+  {
+    heap[index] = slot;
+    position[slot] = static_cast<Slot>(index);
+  }
+
+  void exchange(std::size_t first, std::size_t second)
+  {
+    const auto slot { heap[first] };
+    place(first, heap[second]);
+    place(second, slot);
+  }
+
+  template <typename Less>
+  std::size_t up(std::size_t index, Less less)
+  {
+    while (index > 0)
+    {
+      const auto parent { (index - 1) / 2 };
+
+      if (!less(heap[index], heap[parent])) break;
+
+      exchange(index, parent);
+      index = parent;
+    }
+
+    return index;
+  }
+
+  template <typename Less>
+  void down(std::size_t index, Less less)
+  {
+    while (true)
+    {
+      auto best { index };
+
+      for (auto child { 2 * index + 1 }; child <= 2 * index + 2; ++child)
+        if (child < count && less(heap[child], heap[best])) best = child;
+
+      if (best == index) return;
+
+      exchange(index, best);
+      index = best;
+    }
+  }
+
+  std::array<Slot, Capacity> heap {};
+
+  std::array<Slot, Capacity> position {};
+
+  std::size_t count {};
+};
@@ -1,374 +1,215 @@
-#include <semaphore.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
-#include <sys/wait.h>
-#include <unistd.h>
-
 #include <algorithm>
-#include <array>
 #include <chrono>
-#include <cstdio>
-#include <cstdlib>
-#include <ctime>
+#include <cstdint>
+#include <filesystem>
 #include <format>
 #include <fstream>
-#include <functional>
+#include <optional>
 #include <print>
 #include <random>
-#include <thread>
-#include <utility>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "backend.hpp"
+#include "event_log.hpp"
+#include "metrics.hpp"
 #include "nlohmann/json.hpp"
+#include "replication.hpp"
+#include "simulation.hpp"
+#include "station.hpp"
+#include "trace.hpp"
 
-using time_point = std::chrono::system_clock::time_point;
-
-template <typename T>
-class SharedMemory
-{
- public:
-  ~SharedMemory()
-  {
-    shmdt(object);
-    shmctl(identity, IPC_RMID, nullptr);
-  }
-
-  [[nodiscard]] T* operator->() const { return object; }
-
-  [[nodiscard]] T& operator*() const { return *object; }
-
- private:
-  int identity { shmget(IPC_PRIVATE, sizeof(T), IPC_CREAT | 0666) };
-
-  T* object { new (shmat(identity, nullptr, 0)) T {} };
-};
-
-enum class Fuel
-{
-  AI76,
-  AI92,
-  AI95,
-  COUNT,
-};
-
-inline static void from_json(const nlohmann::json& j, Fuel& fuel)
+void print(const Summary& summary)
 {
-  auto str = j.get<std::string>();
-  if (str == "АИ76")
-    fuel = Fuel::AI76;
-  else if (str == "АИ92")
-    fuel = Fuel::AI92;
-  else if (str == "АИ95")
-    fuel = Fuel::AI95;
-  else
-    throw std::runtime_error("Unknown fuel type: " + str);
+  std::println("  Доля отказов: {:.4f} ± {:.4f}", summary.drop_rate.mean,
+               summary.drop_rate.half_width);
+  std::println("  Доля ушедших из очереди: {:.4f} ± {:.4f}",
+               summary.renege_rate.mean, summary.renege_rate.half_width);
+  std::println("  Среднее ожидание: {:.2f} ± {:.2f} с", summary.mean_wait.mean,
+               summary.mean_wait.half_width);
+  std::println("  p99 ожидания: {:.2f} ± {:.2f} с", summary.p99_wait.mean,
+               summary.p99_wait.half_width);
+
+  for (int index {}; auto const& utilization : summary.utilization)
+    std::println("  Загрузка колонки {}: {:.3f} ± {:.3f}", ++index,
+                 utilization.mean, utilization.half_width);
 }
 
-template <>
-struct std::formatter<Fuel> : std::formatter<std::string_view>
+void sweep(const Scenario& base, const nlohmann::json& grid, int replications,
+           std::uint32_t seed)
 {
-  auto format(Fuel fuel, std::format_context& ctx) const -> decltype(ctx.out())
-  {
-    std::string_view name {};
-
-    if (fuel == Fuel::AI76)
-      name = "АИ76";
-    else if (fuel == Fuel::AI92)
-      name = "АИ92";
-    else if (fuel == Fuel::AI95)
-      name = "АИ95";
-    else
-      name = "Unknown";
-
-    return formatter<std::string_view>::format(name, ctx);
-  }
-};
+  const auto generation_times { grid.value(
+      "mean_generation_time",
+      std::vector<double> { base.mean_generation_time }) };
+  const auto service_times { grid.value("mean_service_time",
+                                        std::vector<double> {}) };
+  const auto max_sizes { grid.value("max_size",
+                                    std::vector<int> { base.max_size }) };
+
+  std::println("Реплик на точку: {}, зерно: {}", replications, seed);
+
+  for (auto const generation_time : generation_times)
+    for (auto const max_size : max_sizes)
+      for (std::size_t service { 0 };
+           service < std::max<std::size_t>(service_times.size(), 1); ++service)
+      {
+        auto scenario { base };
+        scenario.mean_generation_time = generation_time;
+        scenario.max_size = max_size;
+
+        if (!service_times.empty())
+          for (auto& column : scenario.columns)
+            column.mean_service_time = service_times[service];
+
+        const auto started { std::chrono::steady_clock::now() };
+        const auto summary { replicate(scenario, replications, seed) };
+        const std::chrono::duration<double> spent {
+          std::chrono::steady_clock::now() - started
+        };
+
+        std::println(
+            "\nГенерация: {}, обслуживание: {}, размер очереди: {} ({:.2f} с)",
+            generation_time,
+            service_times.empty() ? std::string { "из конфигурации" }
+                                  : std::format("{}", service_times[service]),
+            max_size, spent.count());
+        print(summary);
+      }
+}
 
-struct Column
+// Прогоняет одну и ту же трассу прибытий через модель при каждой политике
+// выбора машины, чтобы сравнивать их на реальном, нестационарном потоке
+void compare(const Scenario& base, int replications, std::uint32_t seed)
 {
-  void serve(int) const;
-
-  Fuel fuel {};
-
-  double mean_service_time {};
+  std::println("Реплик на политику: {}, зерно: {}", replications, seed);
 
-  double standard_deviation {};
-
-  friend void from_json(const nlohmann ::json& nlohmann_json_j,
-                        Column& nlohmann_json_t)
+  for (auto const dispatch : { Dispatch::fifo, Dispatch::shortest_service,
+                               Dispatch::earliest_deadline })
   {
-    const Column nlohmann_json_default_obj {};
-    nlohmann_json_t.fuel =
-        nlohmann_json_j.value("fuel", nlohmann_json_default_obj.fuel);
-    nlohmann_json_t.mean_service_time = nlohmann_json_j.value(
-        "mean_service_time", nlohmann_json_default_obj.mean_service_time);
-    nlohmann_json_t.standard_deviation = nlohmann_json_j.value(
-        "standard_deviation", nlohmann_json_default_obj.standard_deviation);
-  };
-};
+    auto scenario { base };
+    scenario.dispatch = dispatch;
+
+    const auto started { std::chrono::steady_clock::now() };
+    const auto summary { replicate(scenario, replications, seed) };
+    const std::chrono::duration<double> spent {
+      std::chrono::steady_clock::now() - started
+    };
+
+    std::println("\nПолитика: {} ({:.2f} с)",
+                 nlohmann::json(dispatch).get<std::string>(), spent.count());
+    print(summary);
+  }
+}
 
-struct Car
+int main(int argc, char** argv)
 {
-  int id {};
-  Fuel fuel {};
-  time_point timestamp {};
-};
+  nlohmann::json configuration {};
+  std::ifstream { argv[1] } >> configuration;
 
-struct Queue
-{
-  explicit Queue()
-  {
-    sem_init(&mutex, 1, 1);
+  if (configuration.contains("fuels"))
+    Fuels::grades = configuration["fuels"].get<std::vector<FuelGrade>>();
 
-    std::ranges::for_each(fuel_semaphores,
-                          [](auto& semaphore) { sem_init(&semaphore, 1, 0); });
-  };
+  if (Fuels::count() == 0 || Fuels::count() > Record::max_fuels)
+    throw std::runtime_error("Unsupported number of fuel types");
 
-  ~Queue()
-  {
-    sem_destroy(&mutex);
+  if (std::ranges::any_of(Fuels::grades, [](const FuelGrade& grade) {
+        return grade.name.size() > RecordHeader::max_name;
+      }))
+    throw std::runtime_error("Fuel type name is too long");
 
-    std::ranges::for_each(fuel_semaphores,
-                          [](auto& semaphore) { sem_destroy(&semaphore); });
+  const auto columns { configuration["columns"].get<std::vector<Column>>() };
 
-    std::fclose(inserted);
-    std::fclose(dropped);
-  }
+  configuration["generator"].get<Generator>();
 
-  auto lock() { sem_wait(&mutex); }
+  const std::vector<std::string_view> options(argv + std::min(argc, 2),
+                                              argv + argc);
 
-  auto unlock() { sem_post(&mutex); }
+  const auto option { [&](std::string_view name) {
+    return std::ranges::find(options, name) != options.end();
+  } };
 
-  [[nodiscard]] std::optional<Car> find_nearest_car(const Fuel& fuel)
-  {
-    std::optional<Car> result {};
+  const auto option_text { [&](std::string_view name) {
+    auto it { std::ranges::find(options, name) };
 
-    lock();
+    if (it == options.end() || ++it == options.end())
+      return std::optional<std::string> {};
 
-    auto it = std::find_if(cars.begin(), cars.begin() + current_size,
-                           [&](const auto& c) { return c.fuel == fuel; });
+    return std::optional { std::string { *it } };
+  } };
 
-    if (it != cars.begin() + current_size)
-    {
-      result = *it;
+  const auto option_value { [&](std::string_view name, auto fallback) {
+    const auto text { option_text(name) };
 
-      std::move(it + 1, cars.begin() + current_size, it);
-      current_size--;
-    }
+    if (!text) return fallback;
 
-    unlock();
+    return static_cast<decltype(fallback)>(std::stoll(*text));
+  } };
 
-    return result;
-  }
+  std::optional<Trace> trace {};
 
-  auto insert_car(const Car& car)
+  if (const auto path { option_text("--trace") })
   {
-    lock();
-
-    if (current_size < max_size)
-    {
-      cars[current_size++] = car;
-
-      const auto formatted_string { std::format(
-          "Машина попала в очередь: номер - {}, тип топлива - {}, "
-          "временная метка - {:%Y-%m-%d %H:%M:%S}",
-          car.id, car.fuel, car.timestamp) };
-
-      std::println("{}", formatted_string);
-      std::println(inserted, "{}", formatted_string), std::fflush(inserted);
-    }
-    else
-    {
-      const auto formatted_string { std::format(
-          "Машина не попала в очередь: номер - {}, тип топлива - {}, "
-          "временная метка - {:%Y-%m-%d %H:%M:%S}",
-          car.id, car.fuel, car.timestamp) };
-
-      std::println("{}", formatted_string);
-      std::println(dropped, "{}", formatted_string), std::fflush(dropped);
-    }
-
-    unlock();
-  }
-
-  static constexpr auto max_size { 15 };
-
-  std::array<Car, max_size> cars {};
+    // Генератор и модель пишут queue.bin, и отображенная трасса обрезалась
+    // бы под ногами
+    if (std::filesystem::exists("queue.bin") &&
+        std::filesystem::equivalent(*path, "queue.bin"))
+      throw std::runtime_error("Copy queue.bin before replaying it as a trace");
 
-  std::size_t current_size {};
-
-  std::array<sem_t, std::to_underlying(Fuel::COUNT)> fuel_semaphores {};
-
-  sem_t mutex {};
-
-  bool finished { false };
-
-  std::FILE* inserted { std::fopen("inserted.log", "w") };
-
-  std::FILE* dropped { std::fopen("dropped.log", "w") };
-};
-
-struct Generator
-{
-  static void generate();
-
-  static inline auto requests { 150 };
-
-  static inline auto mean_generation_time { 1 };
-
-  static inline auto standard_deviation { 0.5 };
-};
-
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Generator, requests, mean_generation_time, standard_deviation);
-
-auto const queue { SharedMemory<Queue> {} };
-
-std::array columns {
-  Column {
-          .fuel = Fuel::AI76,
-          .mean_service_time = 10,
-          .standard_deviation = 0.5,
-          },
-  Column {
-          .fuel = Fuel::AI76,
-          .mean_service_time = 10,
-          .standard_deviation = 0.5,
-          },
-  Column {
-          .fuel = Fuel::AI92,
-          .mean_service_time = 12.5,
-          .standard_deviation = 0.6,
-          },
-  Column {
-          .fuel = Fuel::AI92,
-          .mean_service_time = 12.5,
-          .standard_deviation = 0.6,
-          },
-  Column {
-          .fuel = Fuel::AI95,
-          .mean_service_time = 15,
-          .standard_deviation = 0.7,
-          },
-};
-
-void Generator::generate()
-{
-  std::normal_distribution<> distribution(mean_generation_time,
-                                          standard_deviation);
-  std::mt19937 number_generator(std::random_device {}());
-
-  for (int request { 0 }; request < requests; ++request)
-  {
-    std::this_thread::sleep_for(
-        std::chrono::duration<double>(distribution(number_generator)));
-
-    const auto fuel { std::invoke([&] {
-      std::uniform_int_distribution<> distribution(0, 4);
-      const auto value { distribution(number_generator) };
-      return value < 2 ? Fuel::AI76 : value < 4 ? Fuel::AI92 : Fuel::AI95;
-    }) };
-
-    queue->insert_car({
-        .id = request,
-        .fuel = fuel,
-        .timestamp = std::chrono::system_clock::now(),
-    });
-
-    sem_post(&queue->fuel_semaphores[std::to_underlying(fuel)]);
+    trace.emplace(*path, std::stod(option_text("--compression").value_or("1")));
   }
 
-  queue->finished = true;
-}
-
-void Column::serve(int index) const
-{
-  std::normal_distribution<> distribution(mean_service_time,
-                                          standard_deviation);
-  std::mt19937 number_generator(std::random_device {}());
-
-  const auto log { std::fopen(std::format("column_{}.log", index).data(),
-                              "w") };
-
-  while (!queue->finished)
-  {
-    sem_wait(&queue->fuel_semaphores[std::to_underlying(fuel)]);
-
-    const auto car { queue->find_nearest_car(fuel) };
+  const Scenario scenario {
+    .columns = columns,
+    .max_size = SharedQueue::max_size,
+    .requests = Generator::requests,
+    .mean_generation_time = Generator::mean_generation_time,
+    .standard_deviation = Generator::standard_deviation,
+    .dispatch = configuration.value("dispatch", Dispatch::fifo),
+    .mean_patience = Generator::mean_patience,
+    .patience_deviation = Generator::patience_deviation,
+    .demand_deviation = Generator::demand_deviation,
+    .trace = trace ? &*trace : nullptr,
+  };
 
-    if (!car) continue;
+  const auto seed { option_value("--seed",
+                                 std::uint32_t { std::random_device {}() }) };
 
-    const auto formatted_string { std::format(
-        "Колонка {} начала обслуживание машины с номером {} и "
-        "типом топлива {} во временной метке {:%Y-%m-%d "
-        "%H:%M:%S}",
-        index, car->id, car->fuel, car->timestamp) };
+  // Одна реплика дает оценку без доверительного интервала
+  const auto replications { option_value("--replications", 1) };
 
-    std::println("{}", formatted_string);
-    std::println(log, "{}", formatted_string), std::fflush(log);
+  if (replications < 1)
+    throw std::runtime_error("--replications must be at least 1");
 
-    std::this_thread::sleep_for(
-        std::chrono::duration<double>(distribution(number_generator)));
+  if (trace && (option("--virtual-time") || option("--replications")))
+  {
+    compare(scenario, replications, seed);
+    return 0;
   }
 
-  while (true)
+  if (option("--replications"))
   {
-    queue->lock();
-    bool has_car = std::any_of(queue->cars.begin(), queue->cars.begin() + queue->current_size,
-                               [&](const Car& c) { return c.fuel == fuel; });
-    queue->unlock();
-
-    if (!has_car)
-      break;
-
-    auto car = queue->find_nearest_car(fuel);
-    if (car)
-    {
-      const auto formatted_string { std::format(
-          "Колонка {} начала обслуживание машины с номером {} и "
-          "типом топлива {} во временной метке {:%Y-%m-%d "
-          "%H:%M:%S}",
-          index, car->id, car->fuel, car->timestamp) };
-
-      std::println("{}", formatted_string);
-      std::println(log, "{}", formatted_string), std::fflush(log);
-
-      std::this_thread::sleep_for(
-          std::chrono::duration<double>(distribution(number_generator)));
-    }
-    else
-    {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    sweep(scenario, configuration.value("sweep", nlohmann::json::object()),
+          replications, seed);
+    return 0;
   }
 
-  std::fclose(log);
-}
-
-int main(int argc, char** argv)
-{
-  nlohmann::json configuration {};
-  std::ifstream { argv[1] } >> configuration;
-  columns = configuration["columns"].get<std::array<Column, 5>>();
-
-  configuration["generator"].get<Generator>();
-
-  std::vector<pid_t> pids;
-
-  for (int index {}; auto column : columns)
+  if (option("--virtual-time"))
   {
-    ++index;
+    Simulation simulation { scenario };
+    simulation.run();
 
-    pids.emplace_back(fork());
-    if (pids.back() != 0) continue;
-
-    column.serve(index);
+    std::println("Моделирование завершено: {} заявок за {:.1f} с модельного "
+                 "времени",
+                 Generator::requests, simulation.elapsed());
     return 0;
   }
 
-  Generator::generate();
-
-  for (const auto& column : columns)
-    sem_post(&queue->fuel_semaphores[std::to_underlying(column.fuel)]);
+  metrics::path = option_text("--metrics").value_or("");
 
-  for (auto const& pid : pids) waitpid(pid, nullptr, 0);
-}
\ No newline at end of file
+  if (option("--threads"))
+    run_threads(columns, scenario.dispatch, scenario.trace);
+  else
+    run_processes(columns, scenario.dispatch, scenario.trace);
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "ring_buffer.hpp"
+#include "station.hpp"
+
+// Гистограмма в духе HDR: значения в микросекундах, каждая октава делится на
+// sub_buckets линейных корзин. Запись — один relaxed fetch_add, поэтому ее
+// можно держать в разделяемой памяти и писать из любого процесса.
+class Histogram
+{
+ public:
+  static constexpr std::size_t sub_buckets { 4 };
+
+  static constexpr std::size_t octaves { 32 };
+
+  static constexpr std::size_t buckets { octaves * sub_buckets };
+
+  void record(std::chrono::microseconds value)
+  {
+    const auto count { static_cast<std::uint64_t>(
+        std::max<std::int64_t>(value.count(), 0)) };
+
+    counts[index(count)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static std::size_t index(std::uint64_t value)
+  {
+    if (value < sub_buckets) return value;
+
+    const auto octave { static_cast<std::size_t>(std::bit_width(value)) - 1 };
+    const auto shift { octave - std::bit_width(sub_buckets) + 1 };
+    const auto sub { (value >> shift) & (sub_buckets - 1) };
+
+    return std::min(buckets - 1, (shift + 1) * sub_buckets + sub);
+  }
+
+  // Наибольшее значение, попадающее в корзину
+  [[nodiscard]] static std::uint64_t upper(std::size_t index)
+  {
+    if (index < sub_buckets) return index;
+
+    const auto shift { index / sub_buckets - 1 };
+    const auto sub { index % sub_buckets };
+
+    return ((sub_buckets + sub + 1) << shift) - 1;
+  }
+
+  std::array<std::atomic<std::uint64_t>, buckets> counts {};
+
+  std::atomic<std::uint64_t> sum {};
+};
+
+struct alignas(cache_line) LaneMetrics
+{
+  std::atomic<std::uint64_t> inserted {};
+
+  std::atomic<std::uint64_t> dropped {};
+
+  std::atomic<std::uint64_t> served {};
+
+  std::atomic<std::uint64_t> reneged {};
+};
+
+struct alignas(cache_line) ColumnMetrics
+{
+  std::atomic<std::uint64_t> served {};
+
+  std::atomic<std::uint64_t> busy_microseconds {};
+};
+
+struct alignas(cache_line) StationMetrics
+{
+  Histogram wait {};
+
+  Histogram service {};
+
+  std::atomic<int> max_depth {};
+
+  void observe_depth(int depth)
+  {
+    auto current { max_depth.load(std::memory_order_relaxed) };
+
+    while (depth > current &&
+           !max_depth.compare_exchange_weak(current, depth,
+                                            std::memory_order_relaxed));
+  }
+};
+
+namespace metrics
+{
+// Файл снимка; пустой путь отключает экспорт
+inline std::string path {};
+
+inline constexpr auto interval { std::chrono::seconds(1) };
+
+inline void header(std::string& out, std::string_view name,
+                   std::string_view help, std::string_view type)
+{
+  std::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", name,
+                 help, name, type);
+}
+
+inline void histogram(std::string& out, std::string_view name,
+                      std::string_view help, const Histogram& histogram)
+{
+  header(out, name, help, "histogram");
+
+  std::uint64_t cumulative {};
+
+  for (std::size_t index {}; index + 1 < Histogram::buckets; ++index)
+  {
+    cumulative += histogram.counts[index].load(std::memory_order_relaxed);
+
+    std::format_to(std::back_inserter(out), "{}_bucket{{le=\"{}\"}} {}\n",
+                   name, static_cast<double>(Histogram::upper(index)) / 1e6,
+                   cumulative);
+  }
+
+  cumulative += histogram.counts.back().load(std::memory_order_relaxed);
+
+  std::format_to(std::back_inserter(out),
+                 "{}_bucket{{le=\"+Inf\"}} {}\n{}_sum {}\n{}_count {}\n", name,
+                 cumulative, name,
+                 static_cast<double>(
+                     histogram.sum.load(std::memory_order_relaxed)) /
+                     1e6,
+                 name, cumulative);
+}
+}  // namespace metrics
+
+// Снимок метрик станции в текстовом формате Prometheus
+template <typename Queue>
+[[nodiscard]] std::string prometheus(Queue& queue,
+                                     std::span<const Column> columns)
+{
+  std::string out {};
+  auto const it { std::back_inserter(out) };
+
+  metrics::header(out, "gas_station_queue_depth",
+                  "Машин в очереди сейчас", "gauge");
+  std::format_to(it, "gas_station_queue_depth {}\n",
+                 queue.current_size.load(std::memory_order_relaxed));
+
+  // Разбивка по топливу — отдельное семейство: сумма его рядов не обязана
+  // совпадать с общей длиной в момент снимка
+  metrics::header(out, "gas_station_fuel_queue_depth",
+                  "Машин в очереди сейчас по видам топлива", "gauge");
+
+  for (std::size_t fuel {}; fuel < Fuels::count(); ++fuel)
+  {
+    const auto& lane { queue.lanes()[fuel].metrics };
+
+    // Счетчики читаются не атомарно вместе: ушедшие из очереди загружаются
+    // раньше вставленных, чтобы разность не ушла ниже нуля и не обернулась
+    const auto left { lane.served.load(std::memory_order_relaxed) +
+                      lane.reneged.load(std::memory_order_relaxed) };
+    const auto inserted { lane.inserted.load(std::memory_order_relaxed) };
+
+    std::format_to(it, "gas_station_fuel_queue_depth{{fuel=\"{}\"}} {}\n",
+                   Fuels::grades[fuel].name,
+                   inserted - std::min(inserted, left));
+  }
+
+  metrics::header(out, "gas_station_queue_depth_max",
+                  "Наибольшая длина очереди с начала работы", "gauge");
+  std::format_to(it, "gas_station_queue_depth_max {}\n",
+                 queue.metrics.max_depth.load(std::memory_order_relaxed));
+
+  const auto per_fuel { [&](std::string_view name, std::string_view help,
+                            auto member) {
+    metrics::header(out, name, help, "counter");
+
+    for (std::size_t fuel {}; fuel < Fuels::count(); ++fuel)
+      std::format_to(it, "{}{{fuel=\"{}\"}} {}\n", name,
+                     Fuels::grades[fuel].name,
+                     (queue.lanes()[fuel].metrics.*member)
+                         .load(std::memory_order_relaxed));
+  } };
+
+  per_fuel("gas_station_cars_inserted_total", "Машин, попавших в очередь",
+           &LaneMetrics::inserted);
+  per_fuel("gas_station_cars_dropped_total", "Машин, не попавших в очередь",
+           &LaneMetrics::dropped);
+  per_fuel("gas_station_cars_served_total", "Машин, взятых на обслуживание",
+           &LaneMetrics::served);
+  per_fuel("gas_station_cars_reneged_total",
+           "Машин, ушедших из очереди без обслуживания",
+           &LaneMetrics::reneged);
+
+  metrics::header(out, "gas_station_column_busy_seconds_total",
+                  "Время обслуживания колонкой; rate() дает загрузку",
+                  "counter");
+
+  for (std::size_t column {}; column < columns.size(); ++column)
+    std::format_to(
+        it, "gas_station_column_busy_seconds_total{{column=\"{}\"}} {}\n",
+        column + 1,
+        static_cast<double>(
+            queue.column_metrics()[column].busy_microseconds.load(
+                std::memory_order_relaxed)) /
+            1e6);
+
+  metrics::histogram(out, "gas_station_wait_seconds",
+                     "Ожидание от прибытия до начала обслуживания",
+                     queue.metrics.wait);
+  metrics::histogram(out, "gas_station_service_seconds",
+                     "Длительность обслуживания", queue.metrics.service);
+
+  return out;
+}
+
+// Периодически записывает снимок в файл (через временный файл и rename, как
+// ожидает textfile collector node_exporter). Читает только атомарные счетчики.
+template <typename Queue>
+class MetricsExporter
+{
+ public:
+  MetricsExporter(Queue& queue, std::span<const Column> columns)
+      : queue { queue }, columns { columns }
+  {
+  }
+
+ private:
+  void write() const
+  {
+    const auto snapshot { prometheus(queue, columns) };
+    const auto temporary { metrics::path + ".tmp" };
+
+    const auto file { std::fopen(temporary.data(), "w") };
+    if (!file) return;
+
+    std::fwrite(snapshot.data(), 1, snapshot.size(), file);
+    std::fclose(file);
+
+    std::rename(temporary.data(), metrics::path.data());
+  }
+
+  Queue& queue;
+
+  std::span<const Column> columns;
+
+  std::mutex mutex {};
+
+  std::condition_variable_any wakeup {};
+
+  std::jthread writer { [this](std::stop_token token) {
+    if (metrics::path.empty()) return;
+
+    std::unique_lock lock { mutex };
+
+    do write();
+    while (!wakeup.wait_for(lock, token, metrics::interval,
+                            [] { return false; }) &&
+           !token.stop_requested());
+
+    write();
+  } };
+};
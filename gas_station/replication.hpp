@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "simulation.hpp"
+
+// Среднее и полуширина 95% доверительного интервала по Стьюденту
+struct Estimate
+{
+  double mean {};
+
+  double half_width {};
+};
+
+struct Summary
+{
+  Estimate drop_rate {};
+
+  Estimate renege_rate {};
+
+  Estimate mean_wait {};
+
+  Estimate p99_wait {};
+
+  std::vector<Estimate> utilization {};
+};
+
+// Квантиль 0.975 распределения Стьюдента с degrees степенями свободы: до 30
+// по таблице, дальше — разложение Корниша — Фишера вокруг нормального
+[[nodiscard]] inline double student_quantile(std::size_t degrees)
+{
+  static constexpr std::array table {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+  };
+
+  if (degrees <= table.size()) return table[degrees - 1];
+
+  constexpr auto z { 1.959964 };
+  const auto d { static_cast<double>(degrees) };
+
+  return z + (z * z * z + z) / (4 * d) +
+         (5 * std::pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * d * d) +
+         (3 * std::pow(z, 7) + 19 * std::pow(z, 5) + 17 * z * z * z -
+          15 * z) /
+             (384 * d * d * d);
+}
+
+[[nodiscard]] inline Estimate estimate(std::span<const double> samples)
+{
+  const auto count { static_cast<double>(samples.size()) };
+
+  if (samples.empty()) return {};
+
+  const auto mean { std::reduce(samples.begin(), samples.end()) / count };
+
+  if (samples.size() < 2) return { .mean = mean };
+
+  const auto variance { std::transform_reduce(
+                            samples.begin(), samples.end(), 0.0, std::plus {},
+                            [&](double sample) {
+                              return (sample - mean) * (sample - mean);
+                            }) /
+                        (count - 1) };
+
+  return {
+    .mean = mean,
+    .half_width =
+        student_quantile(samples.size() - 1) * std::sqrt(variance / count),
+  };
+}
+
+[[nodiscard]] inline double percentile(std::vector<double> values,
+                                       double fraction)
+{
+  if (values.empty()) return 0;
+
+  const auto rank { static_cast<std::size_t>(
+      std::ceil(fraction * static_cast<double>(values.size()))) };
+  const auto nth { values.begin() + (std::max<std::size_t>(rank, 1) - 1) };
+
+  std::ranges::nth_element(values, nth);
+
+  return *nth;
+}
+
+// Прогоняет независимые реплики сценария на всех ядрах. Поток случайных чисел
+// каждой реплики выводится из общего зерна и номера реплики, поэтому
+// результат не зависит от числа потоков и порядка выполнения.
+[[nodiscard]] inline Summary replicate(const Scenario& scenario,
+                                      int replications, std::uint32_t seed)
+{
+  const auto columns { scenario.columns.size() };
+
+  std::vector<double> drop_rates(replications), renege_rates(replications),
+      mean_waits(replications), p99_waits(replications);
+  std::vector<std::vector<double>> utilizations(
+      columns, std::vector<double>(replications));
+
+  std::atomic<int> next {};
+
+  {
+    std::vector<std::jthread> workers {};
+
+    const auto threads { std::max(1u, std::thread::hardware_concurrency()) };
+
+    for (unsigned worker {}; worker < threads; ++worker)
+      workers.emplace_back([&] {
+        for (auto replication { next++ }; replication < replications;
+             replication = next++)
+        {
+          std::seed_seq sequence { seed,
+                                   static_cast<std::uint32_t>(replication) };
+          std::uint32_t stream {};
+          sequence.generate(&stream, &stream + 1);
+
+          Simulation simulation { scenario, stream, false };
+          simulation.run();
+
+          const auto& statistics { simulation.result() };
+
+          const auto arrivals { statistics.inserted + statistics.dropped };
+
+          drop_rates[replication] =
+              arrivals == 0 ? 0
+                            : static_cast<double>(statistics.dropped) /
+                                  arrivals;
+
+          renege_rates[replication] =
+              statistics.inserted == 0
+                  ? 0
+                  : static_cast<double>(statistics.reneged) /
+                        statistics.inserted;
+
+          mean_waits[replication] =
+              statistics.waits.empty()
+                  ? 0
+                  : std::reduce(statistics.waits.begin(),
+                                statistics.waits.end()) /
+                        static_cast<double>(statistics.waits.size());
+
+          p99_waits[replication] = percentile(statistics.waits, 0.99);
+
+          for (std::size_t column {}; column < columns; ++column)
+            utilizations[column][replication] =
+                statistics.elapsed == 0
+                    ? 0
+                    : statistics.busy_time[column] / statistics.elapsed;
+        }
+      });
+  }
+
+  Summary summary {
+    .drop_rate = estimate(drop_rates),
+    .renege_rate = estimate(renege_rates),
+    .mean_wait = estimate(mean_waits),
+    .p99_wait = estimate(p99_waits),
+  };
+
+  for (auto const& utilization : utilizations)
+    summary.utilization.push_back(estimate(utilization));
+
+  return summary;
+}
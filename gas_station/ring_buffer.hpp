@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+inline constexpr std::size_t cache_line { 64 };
+
+// Ограниченная MPMC очередь Вьюкова. Все состояние лежит внутри объекта,
+// поэтому ее можно размещать в разделяемой памяти.
+template <typename T, std::size_t Capacity>
+class RingBuffer
+{
+  static_assert(std::has_single_bit(Capacity));
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(std::atomic<std::size_t>::is_always_lock_free);
+
+ public:
+  RingBuffer()
+  {
+    for (std::size_t index {}; auto& cell : cells)
+      cell.sequence.store(index++, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] bool try_push(const T& value)
+  {
+    auto position { enqueue_position.load(std::memory_order_relaxed) };
+
+    while (true)
+    {
+      auto& cell { cells[position & mask] };
+      auto const sequence { cell.sequence.load(std::memory_order_acquire) };
+      auto const difference { static_cast<std::ptrdiff_t>(sequence) -
+                              static_cast<std::ptrdiff_t>(position) };
+
+      if (difference == 0)
+      {
+        if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                   std::memory_order_relaxed))
+        {
+          cell.value = value;
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+        return false;
+      else
+        position = enqueue_position.load(std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] std::optional<T> try_pop()
+  {
+    auto position { dequeue_position.load(std::memory_order_relaxed) };
+
+    while (true)
+    {
+      auto& cell { cells[position & mask] };
+      auto const sequence { cell.sequence.load(std::memory_order_acquire) };
+      auto const difference { static_cast<std::ptrdiff_t>(sequence) -
+                              static_cast<std::ptrdiff_t>(position + 1) };
+
+      if (difference == 0)
+      {
+        if (dequeue_position.compare_exchange_weak(position, position + 1,
+                                                   std::memory_order_relaxed))
+        {
+          T value { cell.value };
+          cell.sequence.store(position + Capacity, std::memory_order_release);
+          return value;
+        }
+      }
+      else if (difference < 0)
+        return std::nullopt;
+      else
+        position = dequeue_position.load(std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] bool empty() const
+  {
+    return dequeue_position.load(std::memory_order_acquire) >=
+           enqueue_position.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr auto mask { Capacity - 1 };
+
+  struct alignas(cache_line) Cell
+  {
+    std::atomic<std::size_t> sequence {};
+    T value {};
+  };
+
+  std::array<Cell, Capacity> cells {};
+
+  alignas(cache_line) std::atomic<std::size_t> enqueue_position {};
+
+  alignas(cache_line) std::atomic<std::size_t> dequeue_position {};
+};
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "event_log.hpp"
+#include "nlohmann/json.hpp"
+#include "station.hpp"
+#include "trace.hpp"
+
+struct Scenario
+{
+  std::vector<Column> columns {};
+
+  int max_size {};
+
+  int requests {};
+
+  double mean_generation_time {};
+
+  double standard_deviation {};
+
+  Dispatch dispatch {};
+
+  // Терпение машины в очереди; 0 — ждет сколько угодно
+  double mean_patience {};
+
+  double patience_deviation {};
+
+  // Разброс объема заправки: время обслуживания умножается на него
+  double demand_deviation {};
+
+  // Записанная трасса вместо генератора прибытий; не владеет ею
+  const Trace* trace {};
+};
+
+struct Statistics
+{
+  int inserted {};
+
+  int dropped {};
+
+  int reneged {};
+
+  std::vector<double> waits {};
+
+  std::vector<double> busy_time {};
+
+  double elapsed {};
+};
+
+// Дискретно-событийная модель станции: вместо sleep_for время продвигается
+// скачком к ближайшему событию прибытия, окончания обслуживания или ухода
+// машины, которая не дождалась своей очереди.
+class Simulation
+{
+ public:
+  explicit Simulation(Scenario scenario,
+                      std::uint32_t seed = std::random_device {}(),
+                      bool logging = true)
+      : scenario { std::move(scenario) },
+        busy(this->scenario.columns.size()),
+        lanes(Fuels::count()),
+        number_generator { seed }
+  {
+    statistics.busy_time.resize(this->scenario.columns.size());
+
+    if (!logging) return;
+
+    // Те же двоичные журналы, что у процессов и потоков, только без эха в
+    // консоль: их читают decode и --trace
+    queue_log = std::make_unique<EventLog>("queue.bin", false);
+
+    for (int index {}; index < std::ssize(this->scenario.columns); ++index)
+      column_logs.push_back(std::make_unique<EventLog>(
+          std::format("column_{}.bin", index + 1), false));
+  }
+
+  Simulation(const Simulation&) = delete;
+  Simulation& operator=(const Simulation&) = delete;
+
+  void run()
+  {
+    if (scenario.trace)
+    {
+      cursor.emplace(scenario.trace->begin());
+      upcoming = cursor->next();
+
+      if (upcoming) schedule(upcoming->time, EventType::arrival, 0);
+    }
+    else if (scenario.requests > 0)
+      schedule(sample(scenario.mean_generation_time,
+                      scenario.standard_deviation),
+               EventType::arrival, 0);
+
+    while (!events.empty())
+    {
+      const auto event { events.top() };
+      events.pop();
+
+      now = event.time;
+
+      if (event.type == EventType::arrival)
+        arrive(event.index);
+      else if (event.type == EventType::completion)
+        complete(event.index);
+      else
+        renege(event.index);
+    }
+
+    statistics.elapsed = now;
+  }
+
+  [[nodiscard]] double elapsed() const { return now; }
+
+  [[nodiscard]] const Statistics& result() const { return statistics; }
+
+ private:
+  enum class EventType
+  {
+    arrival,
+    completion,
+    renege,
+  };
+
+  struct Event
+  {
+    double time {};
+    std::uint64_t sequence {};
+    EventType type {};
+    int index {};
+
+    auto operator<=>(const Event& other) const
+    {
+      return std::pair { time, sequence } <=>
+             std::pair { other.time, other.sequence };
+    }
+
+    bool operator==(const Event& other) const = default;
+  };
+
+  struct Waiting
+  {
+    Car car {};
+    double arrival {};
+    double deadline {};
+    double demand {};
+  };
+
+  // Ключ внутри полосы: приоритет политики, затем порядок прихода, так что
+  // лучшая машина полосы всегда в begin()
+  struct Key
+  {
+    double priority {};
+    std::uint64_t sequence {};
+
+    auto operator<=>(const Key& other) const = default;
+  };
+
+  using Lane = std::map<Key, Waiting>;
+
+  void schedule(double delay, EventType type, int index)
+  {
+    events.push({
+        .time = now + delay,
+        .sequence = sequence++,
+        .type = type,
+        .index = index,
+    });
+  }
+
+  [[nodiscard]] double sample(double mean, double standard_deviation)
+  {
+    if (standard_deviation <= 0) return std::max(0.0, mean);
+
+    std::normal_distribution<> distribution(mean, standard_deviation);
+    return std::max(0.0, distribution(number_generator));
+  }
+
+  [[nodiscard]] time_point timestamp() const
+  {
+    return epoch + std::chrono::duration_cast<time_point::duration>(
+                       std::chrono::duration<double>(now));
+  }
+
+  [[nodiscard]] double priority(const Waiting& entry) const
+  {
+    if (scenario.dispatch == Dispatch::shortest_service) return entry.demand;
+    if (scenario.dispatch == Dispatch::earliest_deadline) return entry.deadline;
+    return entry.arrival;
+  }
+
+  void arrive(int request)
+  {
+    const Waiting entry {
+      .car = {
+        .id = request,
+        .fuel = cursor ? upcoming->fuel : Fuel { fuels(number_generator) },
+        .timestamp = timestamp(),
+      },
+      .arrival = now,
+      .deadline = scenario.mean_patience > 0
+                      ? now + sample(scenario.mean_patience,
+                                     scenario.patience_deviation)
+                      : std::numeric_limits<double>::infinity(),
+      .demand = sample(1, scenario.demand_deviation),
+    };
+
+    if (waiting < scenario.max_size)
+    {
+      const Key key { priority(entry), sequence++ };
+
+      lanes[entry.car.fuel.index].emplace(key, entry);
+      pending.emplace(request, std::pair { entry.car.fuel.index, key });
+      ++waiting;
+      ++statistics.inserted;
+
+      if (queue_log)
+        queue_log->push(Record::of(Record::Kind::inserted, entry.car));
+
+      if (scenario.mean_patience > 0)
+        schedule(entry.deadline - now, EventType::renege, request);
+
+      dispatch(entry.car.fuel);
+    }
+    else
+    {
+      ++statistics.dropped;
+
+      if (queue_log)
+        queue_log->push(Record::of(Record::Kind::dropped, entry.car));
+    }
+
+    if (cursor)
+    {
+      upcoming = cursor->next();
+
+      if (upcoming)
+        schedule(std::max(0.0, upcoming->time - now), EventType::arrival,
+                 request + 1);
+    }
+    else if (request + 1 < scenario.requests)
+      schedule(sample(scenario.mean_generation_time,
+                      scenario.standard_deviation),
+               EventType::arrival, request + 1);
+  }
+
+  void complete(int column)
+  {
+    busy[column] = false;
+
+    serve(column);
+  }
+
+  void renege(int request)
+  {
+    const auto it { pending.find(request) };
+
+    if (it == pending.end()) return;
+
+    const auto& [lane, key] { it->second };
+    lanes[lane].erase(key);
+
+    pending.erase(it);
+    --waiting;
+    ++statistics.reneged;
+  }
+
+  void dispatch(Fuel fuel)
+  {
+    for (int index {}; index < std::ssize(scenario.columns); ++index)
+      if (!busy[index] && scenario.columns[index].compatible(fuel))
+      {
+        serve(index);
+        return;
+      }
+  }
+
+  // Из всех полос колонки берет машину с наименьшим ключом; многотопливная
+  // колонка при FIFO так получает дольше всех ждущую совместимую машину
+  void serve(int index)
+  {
+    const auto& column { scenario.columns[index] };
+
+    Lane* best {};
+
+    for (auto const& fuel : column.fuels)
+    {
+      auto& lane { lanes[fuel.index] };
+
+      if (lane.empty()) continue;
+
+      if (!best || lane.begin()->first < best->begin()->first) best = &lane;
+    }
+
+    if (!best) return;
+
+    const auto entry { best->begin()->second };
+    best->erase(best->begin());
+    pending.erase(entry.car.id);
+    --waiting;
+
+    busy[index] = true;
+
+    if (!column_logs.empty())
+      column_logs[index]->push(
+          Record::of(Record::Kind::service, entry.car, index + 1));
+
+    const auto service_time { sample(column.mean_service_time,
+                                     column.standard_deviation) *
+                              entry.demand };
+
+    statistics.waits.push_back(now - entry.arrival);
+    statistics.busy_time[index] += service_time;
+
+    schedule(service_time, EventType::completion, index);
+  }
+
+  Scenario scenario {};
+
+  std::vector<bool> busy {};
+
+  std::vector<Lane> lanes {};
+
+  // Номер машины -> полоса и ключ, чтобы уход по таймауту стоил O(log n)
+  std::unordered_map<int, std::pair<int, Key>> pending {};
+
+  int waiting {};
+
+  Statistics statistics {};
+
+  std::priority_queue<Event, std::vector<Event>, std::greater<>> events {};
+
+  std::uint64_t sequence {};
+
+  double now {};
+
+  time_point epoch { std::chrono::system_clock::now() };
+
+  std::mt19937 number_generator;
+
+  std::discrete_distribution<> fuels { Fuels::distribution() };
+
+  std::optional<Trace::Cursor> cursor {};
+
+  std::optional<Arrival> upcoming {};
+
+  std::unique_ptr<EventLog> queue_log {};
+
+  std::vector<std::unique_ptr<EventLog>> column_logs {};
+};
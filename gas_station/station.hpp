@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <random>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+using time_point = std::chrono::system_clock::time_point;
+
+struct Fuel
+{
+  int index {};
+
+  bool operator==(const Fuel&) const = default;
+};
+
+struct FuelGrade
+{
+  std::string name {};
+
+  double weight {};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(FuelGrade, name, weight);
+
+// Каталог топлива задается конфигурацией; по умолчанию совпадает с прежним
+// набором АИ76/АИ92/АИ95 и долями 2/2/1.
+struct Fuels
+{
+  [[nodiscard]] static std::size_t count() { return grades.size(); }
+
+  [[nodiscard]] static std::discrete_distribution<> distribution()
+  {
+    const auto weights { grades | std::views::transform(&FuelGrade::weight) };
+    return { weights.begin(), weights.end() };
+  }
+
+  [[nodiscard]] static Fuel find(std::string_view name)
+  {
+    const auto it { std::ranges::find(grades, name, &FuelGrade::name) };
+
+    if (it == grades.end())
+      throw std::runtime_error("Unknown fuel type: " + std::string { name });
+
+    return { static_cast<int>(std::distance(grades.begin(), it)) };
+  }
+
+  static inline std::vector<FuelGrade> grades {
+    { .name = "АИ76", .weight = 2 },
+    { .name = "АИ92", .weight = 2 },
+    { .name = "АИ95", .weight = 1 },
+  };
+};
+
+inline static void from_json(const nlohmann::json& j, Fuel& fuel)
+{
+  fuel = Fuels::find(j.get<std::string>());
+}
+
+template <>
+struct std::formatter<Fuel> : std::formatter<std::string_view>
+{
+  auto format(Fuel fuel, std::format_context& ctx) const -> decltype(ctx.out())
+  {
+    std::string_view name { "Unknown" };
+
+    if (fuel.index >= 0 && fuel.index < std::ssize(Fuels::grades))
+      name = Fuels::grades[fuel.index].name;
+
+    return formatter<std::string_view>::format(name, ctx);
+  }
+};
+
+// Порядок, в котором свободная колонка выбирает машину из очереди
+enum class Dispatch
+{
+  fifo,
+  shortest_service,
+  earliest_deadline,
+};
+
+struct DispatchName
+{
+  Dispatch dispatch {};
+
+  std::string_view name {};
+};
+
+inline constexpr std::array<DispatchName, 3> dispatch_names { {
+    { Dispatch::fifo, "fifo" },
+    { Dispatch::shortest_service, "shortest_service" },
+    { Dispatch::earliest_deadline, "earliest_deadline" },
+} };
+
+inline void to_json(nlohmann::json& j, Dispatch dispatch)
+{
+  j = std::ranges::find(dispatch_names, dispatch, &DispatchName::dispatch)
+          ->name;
+}
+
+// Опечатка в политике не должна молча превращаться в FIFO
+inline void from_json(const nlohmann::json& j, Dispatch& dispatch)
+{
+  const auto name { j.get<std::string>() };
+  const auto it { std::ranges::find(dispatch_names, name,
+                                    &DispatchName::name) };
+
+  if (it == dispatch_names.end())
+    throw std::invalid_argument("Unknown dispatch policy: " + name);
+
+  dispatch = it->dispatch;
+}
+
+struct Column
+{
+  template <typename Queue>
+  void serve(int, Queue&) const;
+
+  Fuel fuel {};
+
+  double mean_service_time {};
+
+  double standard_deviation {};
+
+  // Все виды топлива колонки; для обычной колонки — только fuel
+  std::vector<Fuel> fuels {};
+
+  [[nodiscard]] bool compatible(const Fuel& other) const
+  {
+    return std::ranges::find(fuels, other) != fuels.end();
+  }
+
+  friend void from_json(const nlohmann ::json& nlohmann_json_j,
+                        Column& nlohmann_json_t)
+  {
+    const Column nlohmann_json_default_obj {};
+    nlohmann_json_t.fuel =
+        nlohmann_json_j.value("fuel", nlohmann_json_default_obj.fuel);
+    nlohmann_json_t.fuels = nlohmann_json_j.value(
+        "fuels", std::vector<Fuel> { nlohmann_json_t.fuel });
+    if (nlohmann_json_t.fuels.empty())
+      throw std::runtime_error("Column must serve at least one fuel type");
+    nlohmann_json_t.fuel = nlohmann_json_t.fuels.front();
+    nlohmann_json_t.mean_service_time = nlohmann_json_j.value(
+        "mean_service_time", nlohmann_json_default_obj.mean_service_time);
+    nlohmann_json_t.standard_deviation = nlohmann_json_j.value(
+        "standard_deviation", nlohmann_json_default_obj.standard_deviation);
+  };
+};
+
+struct Car
+{
+  int id {};
+  Fuel fuel {};
+  time_point timestamp {};
+
+  // Множитель времени обслуживания (объем заправки)
+  double demand { 1 };
+
+  // Момент, когда машина уходит из очереди, не дождавшись колонки
+  time_point deadline { time_point::max() };
+};
+
+class Trace;
+
+struct Generator
+{
+  template <typename Queue>
+  static void generate(Queue&);
+
+  // Прибытия из записанной трассы вместо нормального распределения
+  template <typename Queue>
+  static void replay(Queue&, const Trace&);
+
+  static inline auto requests { 150 };
+
+  static inline auto mean_generation_time { 1.0 };
+
+  static inline auto standard_deviation { 0.5 };
+
+  static inline auto mean_patience { 0.0 };
+
+  static inline auto patience_deviation { 0.0 };
+
+  static inline auto demand_deviation { 0.0 };
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(Generator, requests,
+                                                mean_generation_time,
+                                                standard_deviation,
+                                                mean_patience,
+                                                patience_deviation,
+                                                demand_deviation);
+
+[[nodiscard]] inline std::string inserted_message(const Car& car)
+{
+  return std::format(
+      "Машина попала в очередь: номер - {}, тип топлива - {}, "
+      "временная метка - {:%Y-%m-%d %H:%M:%S}",
+      car.id, car.fuel, car.timestamp);
+}
+
+[[nodiscard]] inline std::string dropped_message(const Car& car)
+{
+  return std::format(
+      "Машина не попала в очередь: номер - {}, тип топлива - {}, "
+      "временная метка - {:%Y-%m-%d %H:%M:%S}",
+      car.id, car.fuel, car.timestamp);
+}
+
+[[nodiscard]] inline std::string service_message(int column, const Car& car)
+{
+  return std::format(
+      "Колонка {} начала обслуживание машины с номером {} и "
+      "типом топлива {} во временной метке {:%Y-%m-%d "
+      "%H:%M:%S}",
+      column, car.id, car.fuel, car.timestamp);
+}
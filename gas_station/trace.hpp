@@ -0,0 +1,240 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "event_log.hpp"
+#include "station.hpp"
+
+struct Arrival
+{
+  // Секунды от начала трассы, уже деленные на коэффициент сжатия
+  double time {};
+
+  Fuel fuel {};
+};
+
+// Записанная трасса прибытий, отображенная в память и читаемая потоково.
+// Формат определяется по содержимому: двоичный журнал queue.bin (прибытия —
+// записи inserted и dropped, время отсчитывается от первой записи) или CSV со
+// строками «время,топливо», где время — секунды от начала, а топливо — имя из
+// каталога. Первая строка CSV может быть заголовком.
+class Trace
+{
+ public:
+  class Cursor
+  {
+   public:
+    [[nodiscard]] std::optional<Arrival> next()
+    {
+      return trace->binary ? next_record() : next_line();
+    }
+
+   private:
+    friend Trace;
+
+    Cursor(const Trace& trace, std::size_t offset)
+        : trace { &trace }, offset { offset }
+    {
+    }
+
+    [[nodiscard]] std::optional<Arrival> next_record()
+    {
+      const auto contents { trace->contents };
+
+      while (offset + sizeof(Record) <= contents.size())
+      {
+        Record record {};
+        std::memcpy(&record, contents.data() + offset, sizeof(record));
+        offset += sizeof(record);
+
+        if (record.kind == Record::Kind::service) continue;
+
+        if (record.fuel >= trace->fuels.size())
+          throw std::runtime_error("Trace record has unknown fuel index");
+
+        const std::chrono::duration<double> time { time_point::duration {
+            record.timestamp - trace->origin } };
+
+        return Arrival {
+          .time = time.count() / trace->compression,
+          .fuel = trace->fuels[record.fuel],
+        };
+      }
+
+      return std::nullopt;
+    }
+
+    [[nodiscard]] std::optional<Arrival> next_line()
+    {
+      const auto contents { trace->contents };
+
+      while (offset < contents.size())
+      {
+        auto end { contents.find('\n', offset) };
+        if (end == std::string_view::npos) end = contents.size();
+
+        auto line { contents.substr(offset, end - offset) };
+        offset = end + 1;
+
+        if (line.ends_with('\r')) line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        const auto comma { line.find(',') };
+
+        double time {};
+        const auto parsed { std::from_chars(
+            line.data(), line.data() + std::min(comma, line.size()), time) };
+
+        if (parsed.ec != std::errc {} || comma == std::string_view::npos)
+          throw std::runtime_error("Malformed trace line: " +
+                                   std::string { line });
+
+        return Arrival {
+          .time = time / trace->compression,
+          .fuel = Fuels::find(line.substr(comma + 1)),
+        };
+      }
+
+      return std::nullopt;
+    }
+
+    const Trace* trace {};
+
+    std::size_t offset {};
+  };
+
+  explicit Trace(const std::string& path, double compression = 1)
+      : compression { compression }
+  {
+    if (compression <= 0)
+      throw std::runtime_error("Trace compression factor must be positive");
+
+    const auto descriptor { open(path.data(), O_RDONLY) };
+
+    if (descriptor == -1)
+      throw std::runtime_error("Cannot open trace: " + path);
+
+    struct stat status {};
+    fstat(descriptor, &status);
+    size = static_cast<std::size_t>(status.st_size);
+
+    if (size > 0)
+      mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+    close(descriptor);
+
+    if (mapping == MAP_FAILED)
+      throw std::runtime_error("Cannot map trace: " + path);
+
+    if (mapping)
+    {
+      madvise(mapping, size, MADV_SEQUENTIAL);
+      contents = { static_cast<const char*>(mapping), size };
+    }
+
+    try
+    {
+      parse_header();
+    }
+    catch (...)
+    {
+      if (mapping) munmap(mapping, size);
+      throw;
+    }
+  }
+
+  Trace(const Trace&) = delete;
+  Trace& operator=(const Trace&) = delete;
+
+  ~Trace()
+  {
+    if (mapping) munmap(mapping, size);
+  }
+
+  // Курсоры независимы, поэтому одну трассу могут читать несколько потоков
+  [[nodiscard]] Cursor begin() const { return { *this, start }; }
+
+ private:
+  // Двоичный журнал хранит свой каталог топлива; индексы переводятся в
+  // каталог текущей конфигурации по имени
+  void parse_header()
+  {
+    RecordHeader header {};
+
+    if (contents.size() < sizeof(header) ||
+        std::memcmp(contents.data(), header.magic.data(), header.magic.size()))
+    {
+      const auto first { contents.substr(0, contents.find('\n')) };
+      double time {};
+
+      if (std::from_chars(first.data(), first.data() + first.size(), time).ec !=
+          std::errc {})
+        start = std::min(first.size() + 1, contents.size());
+
+      return;
+    }
+
+    binary = true;
+
+    std::memcpy(&header, contents.data(), sizeof(header));
+    start = sizeof(header);
+
+    if (header.version != RecordHeader {}.version)
+      throw std::runtime_error("Unsupported trace version");
+
+    for (std::uint32_t fuel {}; fuel < header.fuels; ++fuel)
+    {
+      std::uint32_t length {};
+
+      if (start + sizeof(length) > contents.size())
+        throw std::runtime_error("Truncated trace header");
+
+      std::memcpy(&length, contents.data() + start, sizeof(length));
+      start += sizeof(length);
+
+      if (start + length > contents.size())
+        throw std::runtime_error("Truncated trace header");
+
+      fuels.push_back(Fuels::find(contents.substr(start, length)));
+      start += length;
+    }
+
+    if (start + sizeof(Record) <= contents.size())
+    {
+      Record first {};
+      std::memcpy(&first, contents.data() + start, sizeof(first));
+      origin = first.timestamp;
+    }
+  }
+
+  double compression {};
+
+  void* mapping {};
+
+  std::size_t size {};
+
+  std::string_view contents {};
+
+  bool binary {};
+
+  std::size_t start {};
+
+  std::vector<Fuel> fuels {};
+
+  std::int64_t origin {};
+};
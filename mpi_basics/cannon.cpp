@@ -0,0 +1,145 @@
+#include <mpi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <print>
+#include <span>
+#include <string_view>
+
+#include "matrix.hpp"
+#include "matrix_file.hpp"
+#include "multiply.hpp"
+
+// Алгоритм Кэннона требует квадратного числа рангов. С --benchmark те же
+// матрицы умножаются также полосами строк с рассылкой B и SUMMA.
+
+namespace
+{
+template <class T>
+using Multiply = std::function<double(std::span<const T>, std::span<const T>,
+                                      std::span<T>)>;
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const auto options { matrix::init(argc, argv) };
+
+  const auto benchmark { options.has("--benchmark") };
+
+  const auto product { matrix::product(options, benchmark ? 1024 : 0,
+                                       MPI_COMM_WORLD) };
+  const auto m { product.m }, k { product.k }, n { product.n };
+  const auto panel { std::max(options.value("--panel", 256), 1) };
+  const auto repeats { benchmark ? std::max(options.value("--repeat", 3), 1)
+                                 : 1 };
+
+  // Отладочный вывод, собирает матрицы на корне
+  const auto print { options.has("--print") && std::max({ m, k, n }) <= 16 };
+
+  int rank {};
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  int size {};
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  const auto side { static_cast<int>(std::lround(std::sqrt(size))) };
+  const auto square { side * side == size };
+
+  if (!square && !benchmark)
+  {
+    if (rank == 0)
+      std::println(stderr,
+                   "Алгоритму Кэннона нужно квадратное число рангов, "
+                   "получено {}",
+                   size);
+
+    MPI_Finalize();
+    return 1;
+  }
+
+  if (rank == 0)
+    std::println("Рангов: {}, потоков на ранг {}, {}x{}x{}, тип {}", size,
+                 matrix::threads, m, k, n, options.type);
+
+  matrix::dispatch(options.type, [&]<class T>() {
+    // Каждый алгоритм получает входы в своей раскладке по решетке и лучшее из
+    // repeats время
+    const auto run { [&](std::string_view name, const matrix::Grid& grid,
+                         const Multiply<T>& multiply) {
+      const matrix::Tile tile_A { m, k, grid }, tile_B { k, n, grid },
+          tile_C { m, n, grid };
+
+      const auto A { matrix::load<T>(options.A_path, k, tile_A,
+                                   grid.cart) };
+      const auto B { matrix::load<T>(options.B_path, n, tile_B,
+                                   grid.cart) };
+      auto C { matrix::zeros<T>(tile_C) };
+
+      auto best { std::numeric_limits<double>::infinity() };
+      double kernel {};
+
+      for (int repeat {}; repeat < repeats; ++repeat)
+      {
+        std::ranges::fill(C, T {});
+
+        MPI_Barrier(grid.cart);
+        const auto started { MPI_Wtime() };
+
+        const auto computed { multiply(A, B, C) };
+
+        MPI_Barrier(grid.cart);
+        const auto elapsed { MPI_Wtime() - started };
+
+        double slowest {};
+        MPI_Allreduce(&computed, &slowest, 1, MPI_DOUBLE, MPI_MAX, grid.cart);
+
+        if (elapsed < best)
+        {
+          best = elapsed;
+          kernel = slowest;
+        }
+      }
+
+      if (!options.C_path.empty())
+        matrix::write<T>(options.C_path, m, n, C, tile_C, grid.cart);
+
+      const auto verified { matrix::verify<T>(m, k, A, tile_A, B, tile_B, C,
+                                              tile_C, grid.cart) };
+
+      if (print) matrix::print<T>("C", C, m, n, grid);
+
+      if (grid.rank == 0)
+        std::println("{}: {:.3f} c, {:.2f} GFLOP/s (вычисления {:.3f} c), "
+                     "проверка {}",
+                     name, best, 2.0 * m * n * k / best / 1e9, kernel,
+                     verified ? "пройдена" : "ошибка");
+    } };
+
+    if (square)
+    {
+      const matrix::Grid torus { true };
+
+      run("Кэннон", torus, [&](auto A, auto B, auto C) {
+        return multiply::cannon<T>(m, n, k, A, B, C, torus);
+      });
+    }
+    else if (rank == 0)
+      std::println("Кэннон: пропущен, число рангов не квадрат");
+
+    if (benchmark)
+    {
+      const matrix::Grid grid {}, rows { false, { 0, 1 } };
+
+      run("SUMMA", grid, [&](auto A, auto B, auto C) {
+        return multiply::summa<T>(m, n, k, panel, A, B, C, grid);
+      });
+      run("Полосы строк", rows, [&](auto A, auto B, auto C) {
+        return multiply::rows<T>(m, n, k, A, B, C, rows);
+      });
+    }
+  });
+
+  MPI_Finalize();
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Сравнение чистого MPI (ранг на ядро) и гибридного режима (ранг на узел NUMA,
+# потоки внутри ранга) на одинаковом числе ядер:
+#   hybrid_benchmark.sh <программа> <ядер> <потоков на ранг> [размер]
+set -e
+
+if [ $# -lt 3 ]; then
+  echo "Использование: $0 <программа> <ядер> <потоков на ранг> [размер]" >&2
+  exit 1
+fi
+
+program=$1
+cores=$2
+threads=$3
+size=${4:-2048}
+
+if [ $((cores % threads)) -ne 0 ]; then
+  echo "Число ядер должно делиться на число потоков" >&2
+  exit 1
+fi
+
+echo "Чистый MPI: $cores рангов по 1 потоку"
+mpirun -np "$cores" --bind-to core \
+  "$program" --size "$size" --threads 1
+
+echo "Гибридный режим: $((cores / threads)) рангов по $threads потоков"
+mpirun -np $((cores / threads)) --map-by "numa:PE=$threads" --bind-to core \
+  "$program" --size "$size" --threads "$threads"
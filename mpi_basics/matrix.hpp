@@ -0,0 +1,749 @@
+#pragma once
+
+#include <mpi.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace matrix
+{
+// Тип MPI для элементов T. Определен только для поддерживаемых типов, так
+// что буфер одного типа с типом MPI другого не компилируется.
+template <class T>
+struct Scalar;
+
+template <>
+struct Scalar<float>
+{
+  static MPI_Datatype type() { return MPI_FLOAT; }
+};
+
+template <>
+struct Scalar<double>
+{
+  static MPI_Datatype type() { return MPI_DOUBLE; }
+};
+
+template <>
+struct Scalar<int>
+{
+  static MPI_Datatype type() { return MPI_INT; }
+};
+
+template <>
+struct Scalar<std::int64_t>
+{
+  static MPI_Datatype type() { return MPI_INT64_T; }
+};
+
+template <class T>
+concept Number = requires {
+  { Scalar<T>::type() } -> std::same_as<MPI_Datatype>;
+};
+
+template <Number T>
+MPI_Datatype mpi_type()
+{
+  return Scalar<T>::type();
+}
+
+// Вызывает body.template operator()<T>() с типом элементов по имени:
+// float, double, int или int64
+template <class Body>
+void dispatch(std::string_view name, Body&& body)
+{
+  if (name == "float")
+    body.template operator()<float>();
+  else if (name == "double")
+    body.template operator()<double>();
+  else if (name == "int")
+    body.template operator()<int>();
+  else if (name == "int64")
+    body.template operator()<std::int64_t>();
+  else
+    throw std::invalid_argument("Unknown element type: " +
+                                std::string { name });
+}
+
+// Разбиение total индексов на parts блоков как можно ровнее: первые
+// total % parts блоков на единицу длиннее
+inline int block_size(int total, int parts, int part)
+{
+  return total / parts + (part < total % parts);
+}
+
+inline int block_offset(int total, int parts, int part)
+{
+  return part * (total / parts) + std::min(part, total % parts);
+}
+
+// Номер блока, которому принадлежит index
+inline int block_owner(int total, int parts, int index)
+{
+  const auto size { total / parts }, longer { total % parts };
+  const auto split { longer * (size + 1) };
+
+  return index < split ? index / (size + 1) : longer + (index - split) / size;
+}
+
+// Блочно-строчное разбиение: rows строк по parts рангам, counts и
+// displacements — в элементах, для MPI_Scatterv/MPI_Gatherv
+struct Partition
+{
+  Partition(int rows, int columns, int parts)
+      : counts(parts), displacements(parts)
+  {
+    for (int part {}; part < parts; ++part)
+    {
+      counts[part] = block_size(rows, parts, part) * columns;
+      displacements[part] = block_offset(rows, parts, part) * columns;
+    }
+  }
+
+  std::vector<int> counts {};
+  std::vector<int> displacements {};
+};
+
+// Потоков локальных ядер на ранг в гибридном режиме. MPI вызывает только
+// главный поток, поэтому хватает MPI_THREAD_FUNNELED.
+inline unsigned threads { 1 };
+
+// Параметры командной строки программ умножения
+struct Options
+{
+  Options(int argc, char** argv) : arguments(argv + 1, argv + argc) {}
+
+  [[nodiscard]] bool has(std::string_view name) const
+  {
+    return std::ranges::find(arguments, name) != arguments.end();
+  }
+
+  // Значение за именем; пустая строка, если его нет
+  [[nodiscard]] std::string text(std::string_view name) const
+  {
+    auto it { std::ranges::find(arguments, name) };
+
+    if (it == arguments.end() || ++it == arguments.end()) return {};
+
+    return std::string { *it };
+  }
+
+  [[nodiscard]] int value(std::string_view name, int fallback) const
+  {
+    const auto value { text(name) };
+
+    return value.empty() ? fallback : std::stoi(value);
+  }
+
+  std::vector<std::string_view> arguments {};
+
+  // Входы из файлов --a и --b или сгенерированные, C — в файл --c
+  std::string A_path { text("--a") }, B_path { text("--b") },
+      C_path { text("--c") };
+
+  // Тип элементов: float, double, int или int64
+  std::string type { text("--type").empty() ? "double" : text("--type") };
+};
+
+// Запускает MPI и разбирает общие параметры. Локальные ядра могут работать
+// в нескольких потоках, MPI вызывает только главный. Гибридный режим:
+// --threads потоков на ранг, например по рангу на узел NUMA вместо ранга на
+// ядро.
+inline Options init(int& argc, char**& argv)
+{
+  int provided {};
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+  Options options { argc, argv };
+
+  if (provided >= MPI_THREAD_FUNNELED)
+    threads = std::max(options.value("--threads", 1), 1);
+  else if (options.value("--threads", 1) > 1)
+    std::println(stderr, "MPI не поддерживает MPI_THREAD_FUNNELED, "
+                         "локальные ядра работают в одном потоке");
+
+  return options;
+}
+
+// Постоянные потоки локальных ядер. Часть part любой задачи всегда
+// выполняет один и тот же поток, закрепленный за одним ЦП из набора,
+// доступного рангу; часть 0 — вызывающий поток, тоже закрепленный. Поэтому
+// полоса строк, которую поток первым записал, остается на его узле NUMA и
+// при всех следующих вызовах достается ему же.
+class Pool
+{
+ public:
+  explicit Pool(unsigned size)
+  {
+    cpu_set_t allowed {};
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+      for (int cpu {}; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+
+    pin(0);
+
+    for (unsigned part { 1 }; part < size; ++part)
+      workers.emplace_back([this, part](std::stop_token token) {
+        pin(part);
+        work(static_cast<int>(part), token);
+      });
+  }
+
+  Pool(const Pool&) = delete;
+  Pool& operator=(const Pool&) = delete;
+
+  // Вызывает task(part) для каждой части меньше parts и возвращается, когда
+  // все части выполнены
+  template <class Task>
+  void run(int parts, const Task& task)
+  {
+    {
+      const std::lock_guard lock { mutex };
+
+      call = [](const void* context, int part) {
+        (*static_cast<const Task*>(context))(part);
+      };
+      context = &task;
+      active = parts;
+      remaining = parts - 1;
+      ++generation;
+    }
+
+    start.notify_all();
+
+    task(0);
+
+    std::unique_lock lock { mutex };
+    done.wait(lock, [this] { return remaining == 0; });
+  }
+
+ private:
+  // Часть part закрепляется за ЦП с тем же номером в наборе ранга, по
+  // кругу, если потоков больше, чем ЦП
+  void pin(unsigned part) const
+  {
+    if (cpus.empty()) return;
+
+    cpu_set_t set {};
+    CPU_ZERO(&set);
+    CPU_SET(cpus[part % cpus.size()], &set);
+
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  void work(int part, std::stop_token token)
+  {
+    std::uint64_t seen {};
+
+    while (true)
+    {
+      std::unique_lock lock { mutex };
+
+      if (!start.wait(lock, token, [&] { return generation != seen; })) return;
+
+      seen = generation;
+
+      if (part >= active) continue;
+
+      const auto task { call };
+      const auto argument { context };
+
+      lock.unlock();
+      task(argument, part);
+      lock.lock();
+
+      if (--remaining == 0) done.notify_one();
+    }
+  }
+
+  std::vector<int> cpus {};
+
+  std::mutex mutex {};
+  std::condition_variable_any start {};
+  std::condition_variable done {};
+
+  void (*call)(const void*, int) {};
+  const void* context {};
+  int active {}, remaining {};
+  std::uint64_t generation {};
+
+  // Последним, чтобы потоки остановились раньше, чем разрушится остальное
+  std::vector<std::jthread> workers {};
+};
+
+// Пул создается при первом параллельном вызове, когда threads уже задан
+inline Pool& pool()
+{
+  static Pool instance { threads };
+
+  return instance;
+}
+
+// Делит rows строк плитки на полосы по потокам пула и вызывает
+// body(first, last) для каждой. Разбиение зависит только от rows и
+// threads, а полоса part всегда идет потоку part, поэтому полоса, которую
+// поток первым записал, потом достается ему же.
+template <class Body>
+void parallel_rows(int rows, Body&& body)
+{
+  const auto parts { static_cast<int>(
+      std::clamp(threads, 1u, static_cast<unsigned>(std::max(rows, 1)))) };
+
+  const auto run { [&](int part) {
+    const auto first { block_offset(rows, parts, part) };
+    body(first, first + block_size(rows, parts, part));
+  } };
+
+  if (parts == 1)
+    run(0);
+  else
+    pool().run(parts, run);
+}
+
+// Распределитель, не инициализирующий элементы: страницы буфера получает
+// узел NUMA того потока, который первым в них пишет, а не того, кто буфер
+// создал
+template <class T>
+struct UninitializedAllocator : std::allocator<T>
+{
+  template <class U>
+  struct rebind
+  {
+    using other = UninitializedAllocator<U>;
+  };
+
+  template <class U, class... Arguments>
+  void construct(U* pointer, Arguments&&... arguments)
+  {
+    if constexpr (sizeof...(Arguments) == 0)
+      ::new (static_cast<void*>(pointer)) U;
+    else
+      ::new (static_cast<void*>(pointer))
+          U(std::forward<Arguments>(arguments)...);
+  }
+};
+
+template <Number T = double>
+using Buffer = std::vector<T, UninitializedAllocator<T>>;
+
+namespace detail
+{
+// C += A * B для строчных матриц m x k и k x n с ведущими размерностями
+// lda, ldb, ldc. Обход блоками по k и n держит полосу B в кеше, строки C
+// считаются по четыре, чтобы каждая загруженная строка B шла в четыре
+// суммы. Внутренний цикл по j идет подряд по памяти и векторизуется
+// компилятором (в сборке Release, -O3) на ширину вектора для T: float
+// занимает вдвое больше дорожек, чем double. Блок по n задан в байтах,
+// чтобы полоса B занимала в кеше одно и то же место для любого T.
+template <Number T>
+void gemm(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C,
+          int ldc)
+{
+  constexpr int block_n { 4096 / sizeof(T) };
+  constexpr int block_k { 128 };
+  constexpr int rows { 4 };
+
+  const auto a { [&](int i, int p) {
+    return A[static_cast<std::ptrdiff_t>(i) * lda + p];
+  } };
+  const auto b { [&](int p) {
+    return B + static_cast<std::ptrdiff_t>(p) * ldb;
+  } };
+  const auto c { [&](int i) {
+    return C + static_cast<std::ptrdiff_t>(i) * ldc;
+  } };
+
+  for (int jj {}; jj < n; jj += block_n)
+  {
+    const auto j_end { std::min(jj + block_n, n) };
+
+    for (int pp {}; pp < k; pp += block_k)
+    {
+      const auto p_end { std::min(pp + block_k, k) };
+
+      int i {};
+
+      for (; i + rows <= m; i += rows)
+      {
+        T* __restrict c0 { c(i) };
+        T* __restrict c1 { c(i + 1) };
+        T* __restrict c2 { c(i + 2) };
+        T* __restrict c3 { c(i + 3) };
+
+        for (int p { pp }; p < p_end; ++p)
+        {
+          const T* __restrict row { b(p) };
+          const auto a0 { a(i, p) }, a1 { a(i + 1, p) }, a2 { a(i + 2, p) },
+              a3 { a(i + 3, p) };
+
+          for (int j { jj }; j < j_end; ++j)
+          {
+            const auto value { row[j] };
+            c0[j] += a0 * value;
+            c1[j] += a1 * value;
+            c2[j] += a2 * value;
+            c3[j] += a3 * value;
+          }
+        }
+      }
+
+      for (; i < m; ++i)
+      {
+        T* __restrict c0 { c(i) };
+
+        for (int p { pp }; p < p_end; ++p)
+        {
+          const T* __restrict row { b(p) };
+          const auto a0 { a(i, p) };
+
+          for (int j { jj }; j < j_end; ++j) c0[j] += a0 * row[j];
+        }
+      }
+    }
+  }
+}
+
+}  // namespace detail
+
+// Тот же C += A * B, строки C поделены между потоками
+template <Number T>
+void gemm(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C,
+          int ldc)
+{
+  parallel_rows(m, [&](int first, int last) {
+    const auto row { static_cast<std::ptrdiff_t>(first) };
+
+    detail::gemm(last - first, n, k, A + row * lda, lda, B, ldb, C + row * ldc,
+                 ldc);
+  });
+}
+
+// Двумерная решетка рангов: строки решетки делят строки матриц, столбцы
+// решетки — столбцы. Ненулевые dims фиксируют измерение, например { 0, 1 }
+// дает решетку из полос строк. Ранги не переупорядочиваются, поэтому корень
+// решетки — тот же ранг 0, что и в MPI_COMM_WORLD.
+class Grid
+{
+ public:
+  explicit Grid(bool periodic = false, std::array<int, 2> fixed = {})
+      : dims { fixed }
+  {
+    int size {};
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    MPI_Dims_create(size, 2, dims.data());
+
+    const std::array periods { int { periodic }, int { periodic } };
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims.data(), periods.data(), false,
+                    &cart);
+
+    MPI_Comm_rank(cart, &rank);
+    MPI_Cart_coords(cart, rank, 2, coords.data());
+
+    const std::array keep_column { 0, 1 }, keep_row { 1, 0 };
+    MPI_Cart_sub(cart, keep_column.data(), &row);
+    MPI_Cart_sub(cart, keep_row.data(), &column);
+  }
+
+  Grid(const Grid&) = delete;
+  Grid& operator=(const Grid&) = delete;
+
+  ~Grid()
+  {
+    MPI_Comm_free(&column);
+    MPI_Comm_free(&row);
+    MPI_Comm_free(&cart);
+  }
+
+  [[nodiscard]] int size() const { return dims[0] * dims[1]; }
+
+  MPI_Comm cart {};
+
+  // Ранги одной строки решетки, упорядоченные по столбцу, и наоборот
+  MPI_Comm row {}, column {};
+
+  std::array<int, 2> dims {}, coords {};
+
+  int rank {};
+};
+
+// Прямоугольная часть матрицы: размеры и смещение в целой матрице
+struct Tile
+{
+  Tile(int rows, int columns, int row, int column)
+      : rows { rows }, columns { columns }, row { row }, column { column }
+  {
+  }
+
+  // Плитка матрицы rows x columns, принадлежащая рангу решетки с
+  // координатами coords
+  Tile(int rows, int columns, const Grid& grid, std::array<int, 2> coords)
+      : Tile(block_size(rows, grid.dims[0], coords[0]),
+             block_size(columns, grid.dims[1], coords[1]),
+             block_offset(rows, grid.dims[0], coords[0]),
+             block_offset(columns, grid.dims[1], coords[1]))
+  {
+  }
+
+  Tile(int rows, int columns, const Grid& grid)
+      : Tile(rows, columns, grid, grid.coords)
+  {
+  }
+
+  [[nodiscard]] std::size_t size() const
+  {
+    return static_cast<std::size_t>(rows) * columns;
+  }
+
+  int rows {}, columns {}, row {}, column {};
+};
+
+// Нулевая матрица rows x columns, строки которой первыми записывают потоки
+// пула, что потом будут их считать
+template <Number T = double>
+Buffer<T> zeros(int rows, int columns)
+{
+  Buffer<T> values(static_cast<std::size_t>(rows) * columns);
+
+  parallel_rows(rows, [&](int first, int last) {
+    const auto row { static_cast<std::ptrdiff_t>(columns) };
+
+    std::fill(values.begin() + first * row, values.begin() + last * row, T {});
+  });
+
+  return values;
+}
+
+template <Number T = double>
+Buffer<T> zeros(const Tile& tile)
+{
+  return zeros<T>(tile.rows, tile.columns);
+}
+
+// Плитка матрицы с columns столбцами, заполненная значениями 1..32 по кругу
+// от начала целой матрицы: на маленьких матрицах совпадает с iota(1), на
+// больших не переполняет точность float. Каждый ранг строит свою плитку
+// сам, целая матрица нигде не собирается.
+template <Number T = double>
+Buffer<T> generate(int columns, const Tile& tile)
+{
+  Buffer<T> values(tile.size());
+
+  parallel_rows(tile.rows, [&](int first, int last) {
+    for (int i { first }; i < last; ++i)
+      for (int j {}; j < tile.columns; ++j)
+      {
+        const auto index { static_cast<std::size_t>(tile.row + i) * columns +
+                           tile.column + j };
+        values[static_cast<std::size_t>(i) * tile.columns + j] =
+            static_cast<T>(index % 32 + 1);
+      }
+  });
+
+  return values;
+}
+
+// Проверка по контрольным суммам строк: C * 1 должно совпасть с A * (B * 1).
+// Каждый ранг добавляет вклад своих плиток, суммы складываются по comm:
+// O(mk + kn) вычислений на всех и обмен векторами длины k и 2m. Суммы
+// считаются в double, целые C должны совпасть точно, float — с допуском на
+// k округлений.
+template <Number T = double>
+bool verify(int m, int k, std::type_identity_t<std::span<const T>> A,
+            const Tile& tile_A, std::type_identity_t<std::span<const T>> B,
+            const Tile& tile_B, std::type_identity_t<std::span<const T>> C,
+            const Tile& tile_C, MPI_Comm comm)
+{
+  const auto at { [](std::span<const T> values, const Tile& tile, int i,
+                     int j) {
+    return static_cast<double>(
+        values[static_cast<std::size_t>(i) * tile.columns + j]);
+  } };
+
+  const auto tolerance { std::max(
+      1e-9, k * static_cast<double>(std::numeric_limits<T>::epsilon())) };
+
+  std::vector<double> B_sums(k);
+  for (int p {}; p < tile_B.rows; ++p)
+    for (int j {}; j < tile_B.columns; ++j)
+      B_sums[tile_B.row + p] += at(B, tile_B, p, j);
+
+  MPI_Allreduce(MPI_IN_PLACE, B_sums.data(), k, MPI_DOUBLE, MPI_SUM, comm);
+
+  // Первые m — ожидаемые суммы строк, следующие m — фактические
+  std::vector<double> sums(2 * static_cast<std::size_t>(m));
+
+  for (int i {}; i < tile_A.rows; ++i)
+    for (int p {}; p < tile_A.columns; ++p)
+      sums[tile_A.row + i] += at(A, tile_A, i, p) * B_sums[tile_A.column + p];
+
+  for (int i {}; i < tile_C.rows; ++i)
+    for (int j {}; j < tile_C.columns; ++j)
+      sums[m + tile_C.row + i] += at(C, tile_C, i, j);
+
+  MPI_Allreduce(MPI_IN_PLACE, sums.data(), 2 * m, MPI_DOUBLE, MPI_SUM, comm);
+
+  for (int i {}; i < m; ++i)
+  {
+    const auto expected { sums[i] }, actual { sums[m + i] };
+
+    if (std::abs(expected - actual) > tolerance * std::abs(expected))
+      return false;
+  }
+
+  return true;
+}
+
+// Производный тип MPI, освобождается вместе с объектом
+class Datatype
+{
+ public:
+  Datatype(Datatype&& other) noexcept
+      : type { std::exchange(other.type, MPI_DATATYPE_NULL) }
+  {
+  }
+
+  Datatype(const Datatype&) = delete;
+  Datatype& operator=(const Datatype&) = delete;
+
+  ~Datatype()
+  {
+    if (type != MPI_DATATYPE_NULL) MPI_Type_free(&type);
+  }
+
+  operator MPI_Datatype() const { return type; }
+
+  // Столбец строчной матрицы rows x columns. Протяженность сжата до одного
+  // элемента, поэтому в MPI_Scatter столбец j + 1 начинается сразу за
+  // столбцом j и столбцы уходят прямо из исходной матрицы без транспонирования.
+  static Datatype column(int rows, int columns, MPI_Datatype element)
+  {
+    MPI_Datatype column {};
+    MPI_Type_vector(rows, 1, columns, element, &column);
+
+    MPI_Aint lower_bound {}, extent {};
+    MPI_Type_get_extent(element, &lower_bound, &extent);
+
+    MPI_Datatype resized {};
+    MPI_Type_create_resized(column, 0, extent, &resized);
+    MPI_Type_free(&column);
+
+    return Datatype { resized };
+  }
+
+  // Плитка tile внутри строчной матрицы rows x columns
+  static Datatype tile(int rows, int columns, const Tile& tile,
+                       MPI_Datatype element)
+  {
+    MPI_Datatype type {};
+
+    // Подмассив не может быть пустым
+    if (tile.size() == 0)
+    {
+      MPI_Type_contiguous(0, element, &type);
+      return Datatype { type };
+    }
+
+    const std::array sizes { rows, columns },
+        subsizes { tile.rows, tile.columns }, starts { tile.row, tile.column };
+
+    MPI_Type_create_subarray(2, sizes.data(), subsizes.data(), starts.data(),
+                             MPI_ORDER_C, element, &type);
+
+    return Datatype { type };
+  }
+
+ private:
+  explicit Datatype(MPI_Datatype type) : type { type }
+  {
+    MPI_Type_commit(&this->type);
+  }
+
+  MPI_Datatype type { MPI_DATATYPE_NULL };
+};
+
+// Собирает плитки решетки в целую матрицу на корне, только для отладочного
+// вывода маленьких матриц. Каждая плитка принимается сразу на свое место в
+// матрице.
+template <Number T = double>
+std::vector<T> gather(std::type_identity_t<std::span<const T>> local,
+                      int rows, int columns, const Grid& grid)
+{
+  if (grid.rank != 0)
+  {
+    MPI_Send(local.data(), local.size(), mpi_type<T>(), 0, 0, grid.cart);
+    return {};
+  }
+
+  std::vector<T> whole(Tile { rows, columns, 0, 0 }.size());
+
+  std::vector<Datatype> types {};
+  types.reserve(grid.size());
+  std::vector<MPI_Request> requests(grid.size() + 1);
+
+  for (int other {}; other < grid.size(); ++other)
+  {
+    std::array<int, 2> coords {};
+    MPI_Cart_coords(grid.cart, other, 2, coords.data());
+
+    const auto& type { types.emplace_back(Datatype::tile(
+        rows, columns, { rows, columns, grid, coords }, mpi_type<T>())) };
+
+    MPI_Irecv(whole.data(), 1, type, other, 0, grid.cart, &requests[other]);
+  }
+
+  MPI_Isend(local.data(), local.size(), mpi_type<T>(), 0, 0, grid.cart,
+            &requests.back());
+  MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+  return whole;
+}
+
+template <Number T = double>
+void print(std::string_view name,
+           std::type_identity_t<std::span<const T>> values, int rows,
+           int columns)
+{
+  using namespace std::views;
+
+  std::println("Матрица {} ({}x{}):", name, rows, columns);
+  for (auto const& row : values | chunk(columns))
+  {
+    for (auto const& value : row) std::print("{}\t", value);
+    std::println();
+  }
+}
+
+// Печать плиток решетки на корне
+template <Number T = double>
+void print(std::string_view name,
+           std::type_identity_t<std::span<const T>> local, int rows,
+           int columns, const Grid& grid)
+{
+  const auto whole { gather<T>(local, rows, columns, grid) };
+
+  if (grid.rank == 0) matrix::print<T>(name, whole, rows, columns);
+}
+}  // namespace matrix
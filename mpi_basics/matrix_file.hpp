@@ -0,0 +1,287 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <array>
+#include <concepts>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix.hpp"
+
+// Двоичный файл матрицы: заголовок фиксированного размера и элементы по
+// строкам без промежутков. Каждый ранг читает и пишет только свою плитку
+// через MPI-IO, целая матрица ни на одном ранге не собирается.
+namespace matrix
+{
+enum class Element : std::uint32_t
+{
+  float64 = 1,
+  int32 = 2,
+  float32 = 3,
+  int64 = 4,
+};
+
+// Порядок элементов в файле; плитки вырезаются из него видом файла
+enum class Layout : std::uint32_t
+{
+  row_major = 0,
+};
+
+struct Header
+{
+  std::array<char, 4> magic { 'M', 'T', 'R', 'X' };
+  std::uint32_t version { 1 };
+  std::uint64_t rows {};
+  std::uint64_t columns {};
+  Element element {};
+  Layout layout { Layout::row_major };
+};
+
+static_assert(sizeof(Header) == 32);
+
+namespace detail
+{
+// Код типа элементов в заголовке; тип MPI дает matrix::Scalar
+template <Number T>
+constexpr Element file_element()
+{
+  if constexpr (std::same_as<T, float>)
+    return Element::float32;
+  else if constexpr (std::same_as<T, double>)
+    return Element::float64;
+  else if constexpr (std::same_as<T, int>)
+    return Element::int32;
+  else
+    return Element::int64;
+}
+
+// Байт на элемент; 0 — неизвестный код
+constexpr MPI_Offset element_size(Element element)
+{
+  switch (element)
+  {
+    case Element::float32:
+    case Element::int32:
+      return 4;
+    case Element::float64:
+    case Element::int64:
+      return 8;
+  }
+
+  return 0;
+}
+
+inline MPI_File open(const std::string& path, int mode, MPI_Comm comm)
+{
+  MPI_File file {};
+
+  if (MPI_File_open(comm, path.data(), mode, MPI_INFO_NULL, &file) !=
+      MPI_SUCCESS)
+    throw std::runtime_error("Cannot open matrix file: " + path);
+
+  return file;
+}
+
+inline Header read_header(MPI_File file, const std::string& path)
+{
+  Header header {};
+  MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE,
+                       MPI_STATUS_IGNORE);
+
+  if (header.magic != Header {}.magic || header.version != Header {}.version ||
+      header.layout != Layout::row_major)
+  {
+    MPI_File_close(&file);
+    throw std::runtime_error("Unknown matrix file format: " + path);
+  }
+
+  // Размеры дальше идут в int; элементов должно быть ровно столько, сколько
+  // обещает заголовок, иначе вид файла выйдет за его конец
+  if (header.rows > INT_MAX || header.columns > INT_MAX)
+  {
+    MPI_File_close(&file);
+    throw std::runtime_error("Matrix dimensions exceed INT_MAX: " + path);
+  }
+
+  const auto element { element_size(header.element) };
+
+  MPI_Offset size {};
+  MPI_File_get_size(file, &size);
+
+  if (element == 0 ||
+      header.rows * header.columns >
+          static_cast<std::uint64_t>(
+              (std::numeric_limits<MPI_Offset>::max() - sizeof(Header)) /
+              element) ||
+      size != static_cast<MPI_Offset>(sizeof(Header) +
+                                      header.rows * header.columns * element))
+  {
+    MPI_File_close(&file);
+    throw std::runtime_error("Matrix file size does not match its header: " +
+                             path);
+  }
+
+  return header;
+}
+
+// Вид файла, в котором видна только плитка tile матрицы rows x columns
+inline void set_view(MPI_File file, int rows, int columns, const Tile& tile,
+                     MPI_Datatype element)
+{
+  const auto view { Datatype::tile(rows, columns, tile, element) };
+
+  MPI_File_set_view(file, sizeof(Header), element, view, "native",
+                    MPI_INFO_NULL);
+}
+}  // namespace detail
+
+// Размеры матрицы в файле path (коллективно по comm)
+inline std::pair<int, int> shape(const std::string& path, MPI_Comm comm)
+{
+  auto file { detail::open(path, MPI_MODE_RDONLY, comm) };
+  const auto header { detail::read_header(file, path) };
+  MPI_File_close(&file);
+
+  return { static_cast<int>(header.rows), static_cast<int>(header.columns) };
+}
+
+// Читает плитку tile матрицы из файла path в local (коллективно по comm)
+template <Number T = double>
+void read(const std::string& path, const Tile& tile,
+          std::type_identity_t<std::span<T>> local, MPI_Comm comm)
+{
+  auto file { detail::open(path, MPI_MODE_RDONLY, comm) };
+  const auto header { detail::read_header(file, path) };
+
+  const auto rows { static_cast<int>(header.rows) },
+      columns { static_cast<int>(header.columns) };
+
+  // Плитки у рангов свои, и ранг, бросивший в одиночку, оставил бы
+  // остальных ждать в коллективном чтении; бросают все или никто
+  int mismatch { header.element != detail::file_element<T>() ||
+                 tile.row + tile.rows > rows ||
+                 tile.column + tile.columns > columns ||
+                 local.size() != tile.size() };
+  MPI_Allreduce(MPI_IN_PLACE, &mismatch, 1, MPI_INT, MPI_LOR, comm);
+
+  if (mismatch)
+  {
+    MPI_File_close(&file);
+    throw std::runtime_error("Matrix file does not match the request: " +
+                             path);
+  }
+
+  detail::set_view(file, rows, columns, tile, mpi_type<T>());
+
+  MPI_File_read_at_all(file, 0, local.data(), local.size(), mpi_type<T>(),
+                       MPI_STATUS_IGNORE);
+
+  MPI_File_close(&file);
+}
+
+template <Number T = double>
+std::vector<T> read(const std::string& path, const Tile& tile, MPI_Comm comm)
+{
+  std::vector<T> local(tile.size());
+  read<T>(path, tile, local, comm);
+
+  return local;
+}
+
+// Записывает плитку tile матрицы rows x columns в файл path (коллективно по
+// comm); заголовок пишет ранг 0
+template <Number T = double>
+void write(const std::string& path, int rows, int columns,
+           std::type_identity_t<std::span<const T>> local, const Tile& tile,
+           MPI_Comm comm)
+{
+  auto file { detail::open(path, MPI_MODE_CREATE | MPI_MODE_WRONLY, comm) };
+
+  MPI_File_set_size(file, sizeof(Header) + static_cast<MPI_Offset>(rows) *
+                                               columns * sizeof(T));
+
+  int rank {};
+  MPI_Comm_rank(comm, &rank);
+
+  if (rank == 0)
+  {
+    const Header header { .rows = static_cast<std::uint64_t>(rows),
+                          .columns = static_cast<std::uint64_t>(columns),
+                          .element = detail::file_element<T>() };
+
+    MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+  }
+
+  detail::set_view(file, rows, columns, tile, mpi_type<T>());
+
+  MPI_File_write_at_all(file, 0, local.data(), local.size(), mpi_type<T>(),
+                        MPI_STATUS_IGNORE);
+
+  MPI_File_close(&file);
+}
+
+// Размеры произведения C (m x n) = A (m x k) * B (k x n)
+struct Product
+{
+  int m {}, k {}, n {};
+};
+
+// Размеры из заголовков файлов A и B, если пути заданы, иначе из fallback
+inline Product product(const std::string& A, const std::string& B,
+                       Product fallback, MPI_Comm comm)
+{
+  auto result { fallback };
+
+  if (!A.empty()) std::tie(result.m, result.k) = shape(A, comm);
+
+  if (!B.empty())
+  {
+    const auto [rows, columns] { shape(B, comm) };
+
+    if (!A.empty() && rows != result.k)
+      throw std::runtime_error("Inner dimensions of A and B differ");
+
+    result.k = rows;
+    result.n = columns;
+  }
+
+  return result;
+}
+
+// Размеры из файлов --a и --b, иначе из --m, --k и --n. Без них все три
+// равны --size, а без --size (по умолчанию size) — примеру 4 x 5 x 6.
+inline Product product(const Options& options, int size, MPI_Comm comm)
+{
+  const auto dimension { options.value("--size", size) };
+
+  return product(options.A_path, options.B_path,
+                 { .m = options.value("--m", dimension ? dimension : 4),
+                   .k = options.value("--k", dimension ? dimension : 5),
+                   .n = options.value("--n", dimension ? dimension : 6) },
+                 comm);
+}
+
+// Плитка из файла, если путь задан, иначе сгенерированная. Страницы плитки
+// первыми касаются потоки, которые будут считать ее строки.
+template <Number T = double>
+Buffer<T> load(const std::string& path, int columns, const Tile& tile,
+               MPI_Comm comm)
+{
+  if (path.empty()) return generate<T>(columns, tile);
+
+  auto local { zeros<T>(tile) };
+  read<T>(path, tile, local, comm);
+
+  return local;
+}
+}  // namespace matrix
@@ -0,0 +1,47 @@
+#include <mpi.h>
+
+#include <print>
+#include <string>
+#include <string_view>
+
+#include "matrix.hpp"
+#include "matrix_file.hpp"
+
+// Пишет файл матрицы rows x columns со значениями 1..32 по кругу: каждый
+// ранг строит и пишет свою полосу строк. Тип элементов — float, double
+// (по умолчанию), int или int64.
+// matrix_generate <путь> <строк> <столбцов> [--type <тип>]
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+
+  if (argc != 4 && !(argc == 6 && std::string_view { argv[4] } == "--type"))
+  {
+    int rank {};
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0)
+      std::println(stderr,
+                   "Использование: {} <путь> <строк> <столбцов> "
+                   "[--type <тип>]",
+                   argv[0]);
+
+    MPI_Finalize();
+    return 1;
+  }
+
+  const std::string path { argv[1] };
+  const auto rows { std::stoi(argv[2]) }, columns { std::stoi(argv[3]) };
+
+  matrix::dispatch(argc == 6 ? argv[5] : "double", [&]<class T>() {
+    const matrix::Grid grid { false, { 0, 1 } };
+    const matrix::Tile tile { rows, columns, grid };
+
+    const auto values { matrix::generate<T>(columns, tile) };
+
+    matrix::write<T>(path, rows, columns, values, tile, grid.cart);
+  });
+
+  MPI_Finalize();
+}
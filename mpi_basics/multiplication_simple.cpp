@@ -1,80 +1,89 @@
 #include <mpi.h>
 
-#include <array>
+#include <algorithm>
 #include <print>
-#include <ranges>
 #include <vector>
 
+#include "matrix.hpp"
+#include "matrix_file.hpp"
+#include "multiply.hpp"
+
 // A: {{1,2,3,4,5},{6,7,8,9,10},{11,12,13,14,15},{16,17,18,19,20}}
 // B: {{1,2,3,4,5,6},{7,8,9,10,11,12},{13,14,15,16,17,18},{19,20,21,22,23,24},{25,26,27,28,29,30}}
 // C: {{255, 270, 285, 300, 315, 330}, {580, 620, 660, 700, 740, 780}, {905, 970, 1035, 1100, 1165, 1230}, {1230, 1320, 1410, 1500, 1590, 1680}}
 
 int main(int argc, char** argv)
 {
-  using namespace std::views;
-  using std::ranges::to;
+  const auto options { matrix::init(argc, argv) };
 
-  MPI_Init(&argc, &argv);
+  // C (m x n) = A (m x k) * B (k x n), по умолчанию — пример из комментария
+  const auto [m, k, n] { matrix::product(options, 0, MPI_COMM_WORLD) };
 
-  int rank {};
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  // Отладочный вывод, собирает матрицы на корне
+  const auto print { options.has("--print") && std::max({ m, k, n }) <= 16 };
 
-  int size {};
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  matrix::dispatch(options.type, [&]<class T>() {
+    // Каждый ранг держит полосу строк A, B и C
+    const matrix::Grid grid { false, { 0, 1 } };
 
-  std::vector<double> A {}, B {}, C(4 * 6);  // 4*5, 5*6, 4*6
+    const matrix::Tile tile_A { m, k, grid }, tile_B { k, n, grid },
+        tile_C { m, n, grid };
 
-  std::vector<double> transposed(6 * 5);
+    const auto A { matrix::load<T>(options.A_path, k, tile_A,
+                                   grid.cart) };
+    const auto B { matrix::load<T>(options.B_path, n, tile_B,
+                                   grid.cart) };
+    auto C { matrix::zeros<T>(tile_C) };
 
-  if (rank == 0)
-  {
-    A = iota(1) | take(4 * 5) | to<std::vector<double>>();
+    MPI_Barrier(grid.cart);
+    const auto started { MPI_Wtime() };
 
-    B = iota(1) | take(5 * 6) | to<std::vector<double>>();
+    const auto computed { multiply::rows<T>(m, n, k, A, B, C, grid) };
 
-    for (int i {}; i < 5; ++i)
-      for (int j {}; j < 6; ++j) transposed[j * 5 + i] = B[i * 6 + j];
+    const auto elapsed { MPI_Wtime() - started };
 
-    std::println("Матрица A (4x5):");
-    for (auto const& row : A | chunk(5))
-    {
-      for (auto const& value : row) std::print("{}\t", value);
-      std::println();
-    }
+    std::vector<double> kernel_times(grid.size());
+    MPI_Gather(&computed, 1, MPI_DOUBLE, kernel_times.data(), 1, MPI_DOUBLE, 0,
+               grid.cart);
 
-    std::println("Матрица B (5x6):");
-    for (auto const& row : B | chunk(6))
-    {
-      for (auto const& value : row) std::print("{}\t", value);
-      std::println();
-    }
-  }
+    double slowest {};
+    MPI_Reduce(&elapsed, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, grid.cart);
 
-  std::array<double, 5> row {};
-  MPI_Scatter(A.data(), row.size(), MPI_DOUBLE, row.data(), row.size(),
-              MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (!options.C_path.empty())
+      matrix::write<T>(options.C_path, m, n, C, tile_C, grid.cart);
 
-  std::array<double, 6> local {};
+    const auto verified { matrix::verify<T>(m, k, A, tile_A, B, tile_B, C,
+                                            tile_C, grid.cart) };
 
-  for (auto const& [result, column] : zip(local, transposed | chunk(5)))
-  {
-    MPI_Bcast(column.data(), column.size(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
-
-    for (auto const& [a, b] : zip(row, column)) result += a * b;
-  }
-
-  MPI_Gather(local.data(), local.size(), MPI_DOUBLE, C.data(), local.size(),
-             MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (print)
+    {
+      matrix::print<T>("A", A, m, k, grid);
+      matrix::print<T>("B", B, k, n, grid);
+      matrix::print<T>("C", C, m, n, grid);
+    }
 
-  if (rank == 0)
-  {
-    std::println("Матрица C (4x6):");
-    for (auto const& row : C | chunk(6))
+    if (grid.rank == 0)
     {
-      for (auto const& value : row) std::print("{}\t", value);
-      std::println();
+      const auto gflops { [&](double rows, double seconds) {
+        return seconds > 0 ? 2 * rows * n * k / seconds / 1e9 : 0.0;
+      } };
+
+      for (int other {}; other < grid.size(); ++other)
+      {
+        const auto rows { matrix::block_size(m, grid.size(), other) };
+
+        std::println("Ранг {}: строк {}, {:.3f} c, {:.2f} GFLOP/s", other,
+                     rows, kernel_times[other],
+                     gflops(rows, kernel_times[other]));
+      }
+
+      std::println("Потоков на ранг: {}, тип {}", matrix::threads,
+                   options.type);
+      std::println("Всего: {}x{}x{} за {:.3f} c, {:.2f} GFLOP/s", m, k, n,
+                   slowest, gflops(m, slowest));
+      std::println("Проверка: {}", verified ? "пройдена" : "ошибка");
     }
-  }
+  });
 
   MPI_Finalize();
 }
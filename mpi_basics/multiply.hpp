@@ -0,0 +1,232 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.hpp"
+
+// Распределенные умножения C = A * B над плитками решетки: каждый ранг
+// передает свои плитки A и B (matrix::Tile { m, k, grid } и т. д.), получает
+// свою плитку C и время локальных вычислений. Тип элементов T задается
+// явно: multiply::summa<float>(...).
+namespace multiply
+{
+template <class T>
+using Input = std::type_identity_t<std::span<const T>>;
+
+template <class T>
+using Output = std::type_identity_t<std::span<T>>;
+
+// Полосы строк на решетке P x 1: плитки A, B и C — полосы строк, B
+// собирается целиком на каждом ранге одной коллективной операцией
+template <matrix::Number T = double>
+double rows(int m, int n, int k, Input<T> local_A, Input<T> local_B,
+            Output<T> local_C, const matrix::Grid& grid)
+{
+  const auto rows { matrix::block_size(m, grid.size(), grid.rank) };
+
+  const matrix::Partition rows_of_B { k, n, grid.size() };
+
+  // B читают все потоки, так что страницы лишь раскладываются по ним
+  auto B { matrix::zeros<T>(k, n) };
+  MPI_Allgatherv(local_B.data(), local_B.size(), matrix::mpi_type<T>(),
+                 B.data(), rows_of_B.counts.data(),
+                 rows_of_B.displacements.data(), matrix::mpi_type<T>(),
+                 grid.cart);
+
+  const auto computing { MPI_Wtime() };
+  matrix::gemm(rows, n, k, local_A.data(), k, B.data(), n, local_C.data(), n);
+
+  return MPI_Wtime() - computing;
+}
+
+namespace detail
+{
+// Панели по k режутся на границах плиток A (по столбцам решетки) и B (по
+// строкам решетки), поэтому у каждой панели ровно один владелец
+inline std::vector<int> panel_cuts(int k, int panel, const matrix::Grid& grid)
+{
+  std::vector<int> cuts { 0, k };
+
+  for (int part {}; part < grid.dims[1]; ++part)
+    cuts.push_back(matrix::block_offset(k, grid.dims[1], part));
+
+  for (int part {}; part < grid.dims[0]; ++part)
+    cuts.push_back(matrix::block_offset(k, grid.dims[0], part));
+
+  for (int cut {}; cut < k; cut += panel) cuts.push_back(cut);
+
+  std::ranges::sort(cuts);
+  const auto [first, last] { std::ranges::unique(cuts) };
+  cuts.erase(first, last);
+
+  return cuts;
+}
+
+// Панели одного шага и их незавершенные рассылки
+template <matrix::Number T>
+struct Panels
+{
+  matrix::Buffer<T> A {}, B {};
+  std::array<MPI_Request, 2> requests { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+};
+}  // namespace detail
+
+// SUMMA: A, B и C разложены плитками по решетке P x Q. На каждом шаге
+// владелец панели столбцов A рассылает ее по своей строке решетки, владелец
+// панели строк B — по своему столбцу, и каждый ранг добавляет их
+// произведение к своей плитке C. Рассылка следующей панели идет, пока
+// считается текущая.
+template <matrix::Number T = double>
+double summa(int m, int n, int k, int panel, Input<T> local_A,
+             Input<T> local_B, Output<T> local_C, const matrix::Grid& grid)
+{
+  const matrix::Tile tile_A { m, k, grid }, tile_B { k, n, grid },
+      tile_C { m, n, grid };
+
+  const auto computing { MPI_Wtime() };
+
+  const auto cuts { detail::panel_cuts(k, panel, grid) };
+  const auto steps { static_cast<int>(cuts.size()) - 1 };
+
+  std::array<detail::Panels<T>, 2> buffers {};
+
+  // Строки панели A первыми записывают потоки, которые их потом читают
+  for (auto& panels : buffers)
+  {
+    panels.A = matrix::zeros<T>(tile_C.rows, panel);
+    panels.B = matrix::zeros<T>(panel, tile_C.columns);
+  }
+
+  const auto post { [&](int step) {
+    auto& [A, B, requests] { buffers[step % 2] };
+
+    const auto from { cuts[step] }, width { cuts[step + 1] - cuts[step] };
+    const auto owner_column { matrix::block_owner(k, grid.dims[1], from) };
+    const auto owner_row { matrix::block_owner(k, grid.dims[0], from) };
+
+    if (grid.coords[1] == owner_column)
+      for (int i {}; i < tile_A.rows; ++i)
+        std::copy_n(local_A.begin() +
+                        static_cast<std::size_t>(i) * tile_A.columns +
+                        (from - tile_A.column),
+                    width, A.begin() + static_cast<std::size_t>(i) * width);
+
+    if (grid.coords[0] == owner_row)
+      std::copy_n(local_B.begin() +
+                      static_cast<std::size_t>(from - tile_B.row) *
+                          tile_B.columns,
+                  static_cast<std::size_t>(width) * tile_B.columns, B.begin());
+
+    MPI_Ibcast(A.data(), tile_C.rows * width, matrix::mpi_type<T>(),
+               owner_column, grid.row, &requests[0]);
+    MPI_Ibcast(B.data(), width * tile_C.columns, matrix::mpi_type<T>(),
+               owner_row, grid.column, &requests[1]);
+  } };
+
+  if (steps > 0) post(0);
+
+  for (int step {}; step < steps; ++step)
+  {
+    if (step + 1 < steps) post(step + 1);
+
+    auto& [A, B, requests] { buffers[step % 2] };
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+    const auto width { cuts[step + 1] - cuts[step] };
+    matrix::gemm(tile_C.rows, tile_C.columns, width, A.data(), width,
+                 B.data(), tile_C.columns, local_C.data(), tile_C.columns);
+  }
+
+  return MPI_Wtime() - computing;
+}
+
+// Алгоритм Кэннона на периодической квадратной решетке p x p: после
+// начального сдвига ранг (i, j) держит плитки A(i, i + j) и B(i + j, j),
+// затем p раундов умножения со сдвигом A влево и B вверх на одну позицию.
+// Каждому рангу нужны только две плитки A и две плитки B.
+template <matrix::Number T = double>
+double cannon(int m, int n, int k, Input<T> local_A, Input<T> local_B,
+              Output<T> local_C, const matrix::Grid& grid)
+{
+  const auto p { grid.dims[0] };
+  const auto [i, j] { grid.coords };
+
+  const matrix::Tile tile_C { m, n, grid };
+
+  // Плитки по k разной ширины ходят в буферах под самую широкую, ширина
+  // текущей вычисляется по номеру блока. Буферы размечают потоки пула, как
+  // и плитки.
+  const auto widest { matrix::block_size(k, p, 0) };
+  const auto capacity_A { tile_C.rows * widest },
+      capacity_B { widest * tile_C.columns };
+
+  std::array buffers_A { matrix::zeros<T>(tile_C.rows, widest),
+                         matrix::zeros<T>(tile_C.rows, widest) };
+  std::array buffers_B { matrix::zeros<T>(widest, tile_C.columns),
+                         matrix::zeros<T>(widest, tile_C.columns) };
+
+  const auto type { matrix::mpi_type<T>() };
+
+  std::ranges::copy(local_A, buffers_A[0].begin());
+  std::ranges::copy(local_B, buffers_B[0].begin());
+
+  const auto computing { MPI_Wtime() };
+
+  int source {}, destination {};
+
+  MPI_Cart_shift(grid.cart, 1, -i, &source, &destination);
+  MPI_Sendrecv_replace(buffers_A[0].data(), capacity_A, type,
+                       destination, 0, source, 0, grid.cart,
+                       MPI_STATUS_IGNORE);
+
+  MPI_Cart_shift(grid.cart, 0, -j, &source, &destination);
+  MPI_Sendrecv_replace(buffers_B[0].data(), capacity_B, type,
+                       destination, 0, source, 0, grid.cart,
+                       MPI_STATUS_IGNORE);
+
+  int left {}, right {}, up {}, down {};
+  MPI_Cart_shift(grid.cart, 1, -1, &right, &left);
+  MPI_Cart_shift(grid.cart, 0, -1, &down, &up);
+
+  for (int round {}; round < p; ++round)
+  {
+    auto& current_A { buffers_A[round % 2] };
+    auto& current_B { buffers_B[round % 2] };
+
+    // Следующие плитки уже в пути, пока считаются текущие
+    std::array<MPI_Request, 4> requests { MPI_REQUEST_NULL, MPI_REQUEST_NULL,
+                                          MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+
+    if (round + 1 < p)
+    {
+      auto& next_A { buffers_A[(round + 1) % 2] };
+      auto& next_B { buffers_B[(round + 1) % 2] };
+
+      MPI_Irecv(next_A.data(), capacity_A, type, right, 1, grid.cart,
+                &requests[0]);
+      MPI_Irecv(next_B.data(), capacity_B, type, down, 2, grid.cart,
+                &requests[1]);
+      MPI_Isend(current_A.data(), capacity_A, type, left, 1, grid.cart,
+                &requests[2]);
+      MPI_Isend(current_B.data(), capacity_B, type, up, 2, grid.cart,
+                &requests[3]);
+    }
+
+    const auto width { matrix::block_size(k, p, (i + j + round) % p) };
+    matrix::gemm(tile_C.rows, tile_C.columns, width, current_A.data(), width,
+                 current_B.data(), tile_C.columns, local_C.data(),
+                 tile_C.columns);
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+  }
+
+  return MPI_Wtime() - computing;
+}
+}  // namespace multiply
@@ -9,7 +9,7 @@
 #include <ctime>
 #include <print>
 #include <ranges>
-#include <thread>
+#include <span>
 #include <vector>
 
 namespace
@@ -29,17 +29,34 @@ int main(int argc, char **argv)
   int size {};
   MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-  MPI_Comm cars_communicator {};
-  MPI_Comm_split(MPI_COMM_WORLD, rank != 0, rank, &cars_communicator);
+  // Прогресс машин лежит в окне арбитра: машина пишет свою ячейку через
+  // MPI_Put, арбитр читает локальную память без коллективных операций
+  int *progresses {};
+  MPI_Win window {};
+  MPI_Win_allocate(rank == 0 ? size * sizeof(int) : 0, sizeof(int),
+                   MPI_INFO_NULL, MPI_COMM_WORLD, &progresses, &window);
+
+  // Пассивная синхронизация: одна эпоха доступа на весь прогон
+  MPI_Win_lock_all(0, window);
 
   std::srand(time(nullptr) ^ (getpid() << 16));
 
   if (rank == 0)
   {
+    const std::span all_progresses { progresses,
+                                     static_cast<std::size_t>(size) };
+    auto const progresses_view { all_progresses | std::views::drop(1) };
+
+    const auto progress_of { [](int &cell) {
+      return std::atomic_ref { cell }.load(std::memory_order_relaxed);
+    } };
+
     for (int stage { 0 }; stage != stages; ++stage)
     {
-      std::vector<int> progresses(size);
-      auto const progresses_view { progresses | std::views::drop(1) };
+      // Машины не пишут до сигнала старта, поэтому окно можно обнулить
+      for (auto &cell : all_progresses)
+        std::atomic_ref { cell }.store(0, std::memory_order_relaxed);
+      MPI_Win_sync(window);
 
       int signal {};
       MPI_Bcast(&signal, 1, MPI_INT, 0, MPI_COMM_WORLD);
@@ -47,17 +64,15 @@ int main(int argc, char **argv)
       bool all_finished {};
       while (!all_finished)
       {
-        MPI_Bcast(&signal, 1, MPI_INT, 0, cars_communicator);
-        MPI_Gather(MPI_IN_PLACE, 0, nullptr, progresses.data(), 1, MPI_INT, 0,
-                   cars_communicator);
+        MPI_Win_sync(window);
 
-        for (int car { 0 }; auto &progress : progresses_view)
+        for (int car { 0 }; auto &cell : progresses_view)
           std::println("Арбитр: Автомобиль {}, этап {}, результат {}", ++car,
-                       stage, progress);
+                       stage, progress_of(cell));
 
-        all_finished = std::ranges::all_of(
-            progresses_view,
-            [](auto const &value) { return value == finish_line; });
+        all_finished = std::ranges::all_of(progresses_view, [&](auto &cell) {
+          return progress_of(cell) == finish_line;
+        });
 
         if (all_finished) break;
 
@@ -70,36 +85,29 @@ int main(int argc, char **argv)
   }
   else
   {
-    std::atomic_int progress {};
-
     for (int stage { 0 }; stage != stages; ++stage)
     {
       int signal {};
       MPI_Bcast(&signal, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-      std::jthread jthread { [&] {
-        while (true)
-        {
-          int signal {};
-          MPI_Bcast(&signal, 1, MPI_INT, 0, cars_communicator);
-          MPI_Gather(&progress, 1, MPI_INT, MPI_IN_PLACE, 0, nullptr, 0,
-                     cars_communicator);
-        }
-      } };
-
-      progress = 0;
+      int progress {};
       while (progress < finish_line)
       {
         progress += std::rand() % 10 + 1;
 
         if (progress > finish_line) progress = finish_line;
 
+        // Запись завершается без участия арбитра; flush делает ее видимой
+        MPI_Put(&progress, 1, MPI_INT, 0, rank, 1, MPI_INT, window);
+        MPI_Win_flush(0, window);
+
         usleep((std::rand() % 200 + 100) * 1000);
       }
     }
   }
 
-  MPI_Comm_free(&cars_communicator);
+  MPI_Win_unlock_all(window);
+  MPI_Win_free(&window);
 
   MPI_Finalize();
-}
\ No newline at end of file
+}
@@ -1,94 +1,247 @@
 #include <mpi.h>
-#include <unistd.h>
 
 #include <algorithm>
-#include <cmath>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
-#include <format>
 #include <print>
 #include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
-constexpr auto stages { 3 };
-constexpr auto cars { 5 };
+namespace
+{
+struct Options
+{
+  int stages {};
 
-int main(int argc, char **argv)
+  // Длительность единицы времени машины
+  std::chrono::milliseconds unit {};
+
+  // Неблокирующие Ibcast/Igather: машина начинает следующий этап, пока
+  // арбитр подводит итоги предыдущего
+  bool overlap {};
+
+  bool verbose {};
+};
+
+void score(int stage, std::span<const int> results, std::vector<int> &points,
+           bool verbose)
 {
-  MPI_Init(&argc, &argv);
+  if (verbose) std::println("Результаты этапа {}", stage);
 
-  int rank {};
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  for (int car { 1 }; car < std::ssize(results); ++car)
+  {
+    if (verbose)
+      std::println("Арбитр: Машина {}, результат {}", car, results[car]);
+
+    points[car] += results[car];
+  }
 
+  if (verbose)
+    std::println("Арбитр: Этап {} - все результаты получены", stage);
+}
+
+// Возвращает время гонки на арбитре в секундах
+double arbiter(const Options &options, std::vector<int> &points)
+{
   int size {};
   MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-  MPI_Comm cars_and_arbiter {};
-  MPI_Comm_split(MPI_COMM_WORLD, rank != 0, rank, &cars_and_arbiter);
+  std::vector results(options.stages, std::vector<int>(size));
 
-  if (rank == 0)
-  {
-    std::vector<int> results(size);
-    std::vector<int> points(size);
+  const auto started { MPI_Wtime() };
 
-    for (int stage { 0 }; stage < stages; ++stage)
+  if (!options.overlap)
+  {
+    for (int stage { 0 }; stage < options.stages; ++stage)
     {
       int start_signal {};
       MPI_Bcast(&start_signal, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-      std::println("Арбитр: Этап {} - рассылка сигнала старта", stage);
-
-      MPI_Gather(MPI_IN_PLACE, 0, nullptr, results.data(), 1, MPI_INT, 0,
-                 MPI_COMM_WORLD);
+      if (options.verbose)
+        std::println("Арбитр: Этап {} - рассылка сигнала старта", stage);
 
-      std::println("Результаты этапа {}", stage);
-      for (int car { 1 };
-           auto const &[result, point] :
-           std::ranges::zip_view { results, points } | std::views::drop(1))
-      {
-        std::println("Арбитр: Машина {}, результат {}", ++car, result);
-        point += result;
-      }
+      MPI_Gather(MPI_IN_PLACE, 0, nullptr, results[stage].data(), 1, MPI_INT,
+                 0, MPI_COMM_WORLD);
 
-      std::println("Арбитр: Этап {} - все результаты получены", stage);
+      score(stage, results[stage], points, options.verbose);
     }
 
-    std::vector<std::pair<int, int>> final_results;
-    for (int car { 1 }; car < size; ++car)
-      final_results.emplace_back(points[car], car);
+    return MPI_Wtime() - started;
+  }
 
-    std::ranges::sort(final_results);
+  // Сигнал старта этапа stage + 1 уходит сразу за сбором этапа stage, так что
+  // подсчет очков идет одновременно со следующим этапом машин
+  std::vector<int> start_signals(options.stages);
+  std::vector<MPI_Request> starts(options.stages), gathers(options.stages);
 
-    std::println("Итоговые результаты:");
-    for (int place { 1 }; auto const &[score, car] : final_results)
-      std::println("Место {}: Машина {} (Всего очков: {})", place++, car,
-                   score);
+  MPI_Ibcast(&start_signals[0], 1, MPI_INT, 0, MPI_COMM_WORLD, &starts[0]);
+
+  for (int stage { 0 }; stage < options.stages; ++stage)
+  {
+    if (options.verbose)
+      std::println("Арбитр: Этап {} - рассылка сигнала старта", stage);
+
+    MPI_Igather(MPI_IN_PLACE, 0, nullptr, results[stage].data(), 1, MPI_INT, 0,
+                MPI_COMM_WORLD, &gathers[stage]);
+
+    if (stage + 1 < options.stages)
+      MPI_Ibcast(&start_signals[stage + 1], 1, MPI_INT, 0, MPI_COMM_WORLD,
+                 &starts[stage + 1]);
+
+    MPI_Wait(&gathers[stage], MPI_STATUS_IGNORE);
+
+    score(stage, results[stage], points, options.verbose);
   }
-  else
+
+  MPI_Waitall(options.stages, starts.data(), MPI_STATUSES_IGNORE);
+
+  return MPI_Wtime() - started;
+}
+
+void car(const Options &options, std::span<const int> times, int rank,
+         MPI_Comm cars_and_arbiter)
+{
+  std::vector<MPI_Request> gathers(options.stages, MPI_REQUEST_NULL);
+
+  for (int stage { 0 }; stage < options.stages; ++stage)
   {
-    std::srand(std::time(nullptr) + rank);
+    int start_signal {};
 
-    for (int stage { 0 }; stage < stages; ++stage)
+    if (options.overlap)
     {
-      int start_signal {};
+      MPI_Request start {};
+      MPI_Ibcast(&start_signal, 1, MPI_INT, 0, MPI_COMM_WORLD, &start);
+      MPI_Wait(&start, MPI_STATUS_IGNORE);
+    }
+    else
       MPI_Bcast(&start_signal, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
+    if (options.verbose)
       std::println("Машина {}: Этап {} - сигнал старта получен", rank, stage);
 
-      auto const time { std::rand() % 10 + 1 };
-      sleep((int)time);
+    std::this_thread::sleep_for(options.unit * times[stage]);
 
-      MPI_Gather(&time, 1, MPI_INT, nullptr, 0, MPI_INT, 0, MPI_COMM_WORLD);
+    if (options.overlap)
+      MPI_Igather(&times[stage], 1, MPI_INT, nullptr, 0, MPI_INT, 0,
+                  MPI_COMM_WORLD, &gathers[stage]);
+    else
+      MPI_Gather(&times[stage], 1, MPI_INT, nullptr, 0, MPI_INT, 0,
+                 MPI_COMM_WORLD);
 
+    if (options.verbose)
       std::println("Машина {}: Этап {} - результат отправлен арбитру", rank,
                    stage);
 
-      MPI_Barrier(cars_and_arbiter);
+    if (!options.overlap) MPI_Barrier(cars_and_arbiter);
+  }
+
+  MPI_Waitall(options.stages, gathers.data(), MPI_STATUSES_IGNORE);
+}
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int rank {};
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  int size {};
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  const std::vector<std::string_view> options(argv + 1, argv + argc);
+
+  const auto option { [&](std::string_view name) {
+    return std::ranges::find(options, name) != options.end();
+  } };
+
+  const auto option_value { [&](std::string_view name, int fallback) {
+    auto it { std::ranges::find(options, name) };
+
+    if (it == options.end() || ++it == options.end()) return fallback;
+
+    return std::stoi(std::string { *it });
+  } };
+
+  MPI_Comm cars_and_arbiter {};
+  MPI_Comm_split(MPI_COMM_WORLD, rank != 0, rank, &cars_and_arbiter);
+
+  const auto benchmark { option("--benchmark") };
+
+  Options settings {
+    .stages = option_value("--stages", benchmark ? 10 : 3),
+    .unit = std::chrono::milliseconds(
+        option_value("--unit-ms", benchmark ? 10 : 1000)),
+    .overlap = option("--overlap"),
+    .verbose = !benchmark,
+  };
+
+  // Времена этапов разыгрываются заранее, чтобы оба режима сравнения
+  // проходили одну и ту же гонку
+  std::srand(benchmark ? rank : std::time(nullptr) + rank);
+
+  std::vector<int> times(settings.stages);
+  for (auto &time : times) time = std::rand() % 10 + 1;
+
+  std::vector<int> points(size);
+
+  if (benchmark)
+  {
+    double elapsed[2] {};
+
+    for (auto const overlap : { false, true })
+    {
+      settings.overlap = overlap;
+
+      MPI_Barrier(MPI_COMM_WORLD);
+
+      if (rank == 0)
+        elapsed[overlap] = arbiter(settings, points);
+      else
+        car(settings, times, rank, cars_and_arbiter);
+    }
+
+    if (rank == 0)
+    {
+      const auto per_stage { [&](double seconds) {
+        return seconds * 1000 / settings.stages;
+      } };
+
+      std::println("Рангов: {}, этапов: {}, единица времени: {} мс", size,
+                   settings.stages, settings.unit.count());
+      std::println("Блокирующий режим: {:.2f} мс на этап",
+                   per_stage(elapsed[0]));
+      std::println("Неблокирующий режим: {:.2f} мс на этап",
+                   per_stage(elapsed[1]));
+      std::println("Экономия: {:.2f} мс на этап",
+                   per_stage(elapsed[0] - elapsed[1]));
     }
   }
+  else if (rank == 0)
+  {
+    arbiter(settings, points);
+
+    std::vector<std::pair<int, int>> final_results;
+    for (int car { 1 }; car < size; ++car)
+      final_results.emplace_back(points[car], car);
+
+    std::ranges::sort(final_results);
+
+    std::println("Итоговые результаты:");
+    for (int place { 1 }; auto const &[score, car] : final_results)
+      std::println("Место {}: Машина {} (Всего очков: {})", place++, car,
+                   score);
+  }
+  else
+    car(settings, times, rank, cars_and_arbiter);
 
   MPI_Comm_free(&cars_and_arbiter);
 
   MPI_Finalize();
-}
\ No newline at end of file
+}
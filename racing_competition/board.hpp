@@ -0,0 +1,206 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/shm.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+
+inline constexpr std::size_t cache_line { 64 };
+
+// Монотонное время в наносекундах; CLOCK_MONOTONIC общий для всех процессов
+[[nodiscard]] inline std::int64_t monotonic_now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Progress
+{
+  int progress {};
+
+  // Место на финише; 0 — машина еще едет
+  int order {};
+};
+
+// Ячейка машины на отдельной кэш-линии. Писатель у нее один — сама машина,
+// поэтому seqlock обходится без CAS, а арбитр читает согласованную пару
+// значений без блокировок и системных вызовов.
+class alignas(cache_line) Slot
+{
+ public:
+  void store(Progress value)
+  {
+    const auto current { sequence.load(std::memory_order_relaxed) };
+
+    sequence.store(current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    progress.store(value.progress, std::memory_order_relaxed);
+    order.store(value.order, std::memory_order_relaxed);
+
+    sequence.store(current + 2, std::memory_order_release);
+  }
+
+  [[nodiscard]] Progress load() const
+  {
+    while (true)
+    {
+      const auto before { sequence.load(std::memory_order_acquire) };
+
+      if (before & 1) continue;
+
+      const Progress value {
+        .progress = progress.load(std::memory_order_relaxed),
+        .order = order.load(std::memory_order_relaxed),
+      };
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if (sequence.load(std::memory_order_relaxed) == before) return value;
+    }
+  }
+
+  // Задержка старта машины в этапе; читается арбитром после ее финиша
+  void record_skew(std::int64_t nanoseconds)
+  {
+    skew.store(nanoseconds, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] std::int64_t start_skew() const
+  {
+    return skew.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<std::uint32_t> sequence {};
+
+  std::atomic<int> progress {};
+
+  std::atomic<int> order {};
+
+  std::atomic<std::int64_t> skew {};
+};
+
+// Табло этапа: счетчик мест и ячейки машин сразу за ним в том же сегменте
+class alignas(cache_line) Board
+{
+ public:
+  explicit Board(std::size_t cars) : cars { cars }
+  {
+    std::uninitialized_value_construct_n(slots().data(), cars);
+  }
+
+  ~Board() { std::destroy_n(slots().data(), cars); }
+
+  [[nodiscard]] static std::size_t size(std::size_t cars)
+  {
+    return sizeof(Board) + cars * sizeof(Slot);
+  }
+
+  [[nodiscard]] std::span<Slot> slots()
+  {
+    return { std::launder(reinterpret_cast<Slot*>(this + 1)), cars };
+  }
+
+  // Место определяется порядком fetch_add, а не порядком прихода сообщений
+  [[nodiscard]] int finish()
+  {
+    return finish_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  // Вызывается арбитром до старта этапа, пока машины ничего не пишут
+  void reset()
+  {
+    finish_counter.store(0, std::memory_order_relaxed);
+
+    for (auto& slot : slots()) slot.store({});
+  }
+
+  // Барьер этапов — номер открытого этапа. Машины ждут его на futex, поэтому
+  // открытие, случившееся раньше ожидания, не теряется, а все ждущие
+  // просыпаются одним системным вызовом
+  void open(std::uint32_t stage)
+  {
+    released.store(monotonic_now(), std::memory_order_relaxed);
+    generation.store(stage, std::memory_order_release);
+
+    futex(FUTEX_WAKE, INT_MAX);
+  }
+
+  // Возвращает задержку между открытием этапа и пробуждением в наносекундах
+  [[nodiscard]] std::int64_t wait(std::uint32_t stage)
+  {
+    for (auto current { generation.load(std::memory_order_acquire) };
+         current < stage; current = generation.load(std::memory_order_acquire))
+      futex(FUTEX_WAIT, current);
+
+    return monotonic_now() - released.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Без FUTEX_PRIVATE_FLAG: слово лежит в разделяемой памяти
+  long futex(int operation, std::uint32_t value)
+  {
+    return syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&generation),
+                   operation, value, nullptr, nullptr, 0);
+  }
+
+  std::size_t cars {};
+
+  alignas(cache_line) std::atomic<int> finish_counter {};
+
+  alignas(cache_line) std::atomic<std::uint32_t> generation {};
+
+  std::atomic<std::int64_t> released {};
+};
+
+// Табло в разделяемой памяти SysV; дочерние процессы наследуют отображение
+class SharedBoard
+{
+ public:
+  explicit SharedBoard(std::size_t cars)
+      : id { shmget(IPC_PRIVATE, Board::size(cars), IPC_CREAT | 0666) }
+  {
+    if (id == -1) throw std::runtime_error("Cannot allocate progress board");
+
+    const auto address { shmat(id, nullptr, 0) };
+
+    if (address == reinterpret_cast<void*>(-1))
+    {
+      shmctl(id, IPC_RMID, nullptr);
+      throw std::runtime_error("Cannot attach progress board");
+    }
+
+    board = new (address) Board { cars };
+  }
+
+  SharedBoard(const SharedBoard&) = delete;
+  SharedBoard& operator=(const SharedBoard&) = delete;
+
+  ~SharedBoard()
+  {
+    board->~Board();
+    shmdt(board);
+    shmctl(id, IPC_RMID, nullptr);
+  }
+
+  Board* operator->() const { return board; }
+
+  Board& operator*() const { return *board; }
+
+ private:
+  int id {};
+
+  Board* board {};
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+// Событие гонки: машина car в этапе stage на тике tick (мс от открытия
+// этапа) проехала progress; order — место на финише, 0 — еще едет
+struct JournalEntry
+{
+  std::uint32_t tick {};
+  std::uint32_t car {};
+  std::uint32_t order {};
+  std::uint16_t stage {};
+  std::uint16_t progress {};
+};
+
+static_assert(sizeof(JournalEntry) == 16);
+
+struct JournalHeader
+{
+  std::array<char, 4> magic { 'R', 'C', 'J', 'L' };
+  std::uint32_t version { 1 };
+  std::uint32_t cars {};
+  std::uint32_t stages {};
+  std::uint32_t seed {};
+};
+
+// Журнал только дописывается: заголовок с параметрами гонки и затем записи
+// фиксированного размера через буфер stdio
+class Journal
+{
+ public:
+  Journal(const std::string& path, const JournalHeader& header)
+      : file { std::fopen(path.data(), "wb") }
+  {
+    if (!file) throw std::runtime_error("Cannot open journal: " + path);
+
+    std::fwrite(&header, sizeof(header), 1, file);
+  }
+
+  Journal(const Journal&) = delete;
+  Journal& operator=(const Journal&) = delete;
+
+  ~Journal() { std::fclose(file); }
+
+  void append(const JournalEntry& entry)
+  {
+    std::fwrite(&entry, sizeof(entry), 1, file);
+  }
+
+ private:
+  std::FILE* file {};
+};
+
+class JournalReader
+{
+ public:
+  explicit JournalReader(const std::string& path)
+      : file { std::fopen(path.data(), "rb") }
+  {
+    if (!file) throw std::runtime_error("Cannot open journal: " + path);
+
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != JournalHeader {}.magic ||
+        header.version != JournalHeader {}.version)
+    {
+      std::fclose(file);
+      throw std::runtime_error("Unknown journal format: " + path);
+    }
+  }
+
+  JournalReader(const JournalReader&) = delete;
+  JournalReader& operator=(const JournalReader&) = delete;
+
+  ~JournalReader() { std::fclose(file); }
+
+  [[nodiscard]] std::optional<JournalEntry> next()
+  {
+    JournalEntry entry {};
+
+    if (std::fread(&entry, sizeof(entry), 1, file) != 1) return std::nullopt;
+
+    return entry;
+  }
+
+  JournalHeader header {};
+
+ private:
+  std::FILE* file {};
+};
@@ -1,85 +1,178 @@
-#include <sys/msg.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #include <algorithm>
-#include <array>
-#include <atomic>
-#include <csignal>
+#include <chrono>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <format>
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <optional>
 #include <print>
+#include <queue>
 #include <random>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "board.hpp"
+#include "journal.hpp"
+#include "renderer.hpp"
+#include "scheduler.hpp"
 
 namespace
 {
-constexpr auto number_of_stages { 3 };
-constexpr auto cars_number { 5 };
 constexpr auto finish_line { 100 };
 constexpr auto track_length { 50 };
-
-std::atomic_bool start_flag {};
-std::atomic_bool next_flag {};
 }  // namespace
 
-struct ProgressMessage
+using Engine = std::minstd_rand;
+
+// Поток случайных чисел машины выводится из общего зерна и номера машины,
+// поэтому не зависит ни от режима, ни от порядка запуска
+[[nodiscard]] Engine stream(std::uint32_t seed, int car)
 {
-  long mtype { 1 };
-  int id {};
-  int progress {};
-  int finished {};
+  std::seed_seq sequence { seed, static_cast<std::uint32_t>(car) };
+  std::uint32_t value {};
+  sequence.generate(&value, &value + 1);
+
+  return Engine { value };
+}
+
+// Зерно турнира tournament — выход SplitMix64 с позиции tournament потока,
+// начатого с seed. Соседние турниры получают несвязанные зерна, а не
+// seed + 1, seed + 2, ..., чьи потоки машин пересекаются.
+[[nodiscard]] std::uint32_t tournament_seed(std::uint32_t seed,
+                                            int tournament)
+{
+  auto value { seed + (static_cast<std::uint64_t>(tournament) + 1) *
+                          0x9e3779b97f4a7c15 };
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+
+  return static_cast<std::uint32_t>((value ^ (value >> 31)) >> 32);
+}
+
+struct Step
+{
+  int distance {};
+
+  std::chrono::milliseconds pause {};
 };
 
-class Car
+// Шаг машины и пауза после него; все режимы тянут числа в одном порядке
+[[nodiscard]] Step next_step(Engine& engine)
 {
- public:
-  void start(int id, int queue)
+  std::uniform_int_distribution<> distance(1, 10);
+  std::uniform_int_distribution<> pause(100, 300);
+
+  return {
+    .distance = distance(engine),
+    .pause = std::chrono::milliseconds(pause(engine)),
+  };
+}
+
+// Этап в модельном времени: те же шаги и паузы, что у живых машин, но без
+// sleep. События выдаются в порядке времени, одновременные — по номеру машины.
+template <typename Callback>
+void simulate_stage(int stage, std::span<Engine> engines, Callback&& on_event)
+{
+  using Pending = std::pair<std::uint32_t, std::uint32_t>;
+
+  std::priority_queue<Pending, std::vector<Pending>, std::greater<>> pending {};
+  std::vector<int> progress(engines.size());
+
+  for (std::uint32_t car {}; car < engines.size(); ++car)
+    pending.emplace(0, car);
+
+  std::uint32_t finished {};
+
+  while (!pending.empty())
   {
-    signal(SIGUSR1, [](int) { start_flag = true; });
-    signal(SIGUSR2, [](int) { next_flag = true; });
+    const auto [tick, car] { pending.top() };
+    pending.pop();
+
+    JournalEntry entry {
+      .tick = tick,
+      .car = car,
+      .stage = static_cast<std::uint16_t>(stage),
+    };
+
+    if (progress[car] == finish_line)
+    {
+      entry.order = ++finished;
+      entry.progress = finish_line;
+      on_event(entry);
+      continue;
+    }
 
-    std::mt19937 generator(std::random_device {}());
-    std::uniform_int_distribution<> step_dist(1, 10);
-    std::uniform_int_distribution<> sleep_dist(100, 300);
+    const auto step { next_step(engines[car]) };
 
+    progress[car] = std::min(progress[car] + step.distance, finish_line);
+
+    entry.progress = static_cast<std::uint16_t>(progress[car]);
+    on_event(entry);
+
+    pending.emplace(tick + step.pause.count(), car);
+  }
+}
+
+class Car
+{
+ public:
+  void start(int id, Board& board, int number_of_stages, Engine engine)
+  {
     for (int stage { 1 }; stage <= number_of_stages; ++stage)
     {
-      while (!start_flag) pause();
-      start_flag = false;
+      auto& slot { board.slots()[id] };
+      slot.record_skew(board.wait(stage));
 
       progress = 0;
-      finished = false;
-      order = 0;
 
       while (progress < finish_line)
       {
-        progress = std::min(progress + step_dist(generator), finish_line);
+        const auto step { next_step(engine) };
 
-        ProgressMessage message {
-          .id = id,
-          .progress = progress,
-        };
-        msgsnd(queue, &message, sizeof(message) - sizeof(long), 0);
+        progress = std::min(progress + step.distance, finish_line);
+        slot.store({ .progress = progress });
 
-        usleep(sleep_dist(generator) * 1000);
+        std::this_thread::sleep_for(step.pause);
       }
 
-      ProgressMessage message {
-        .id = id,
-        .progress = progress,
-        .finished = 1,
-      };
-      msgsnd(queue, &message, sizeof(message) - sizeof(long), 0);
+      slot.store({ .progress = progress, .order = board.finish() });
+    }
+  }
+
+  // Один этап машины как корутина: вместо sleep корутина засыпает в колесе
+  // таймеров своего потока, поэтому тысячи машин обходятся парой потоков
+  static Drive drive(int id, int stage, Board& board, Worker& worker,
+                     Engine& engine)
+  {
+    auto& slot { board.slots()[id] };
+    slot.record_skew(board.wait(stage));
 
-      if (stage == number_of_stages) continue;
+    int progress {};
+
+    while (progress < finish_line)
+    {
+      const auto step { next_step(engine) };
 
-      while (!next_flag) pause();
-      next_flag = false;
+      progress = std::min(progress + step.distance, finish_line);
+      slot.store({ .progress = progress });
+
+      co_await worker.sleep(step.pause);
     }
+
+    slot.store({ .progress = progress, .order = board.finish() });
   }
 
   int progress {};
@@ -88,30 +181,86 @@ class Car
   bool finished {};
 };
 
+struct Settings
+{
+  int cars {};
+
+  int stages {};
+
+  // Корутины на пуле из workers потоков вместо процесса на машину
+  bool coroutines {};
+
+  unsigned workers {};
+
+  std::chrono::milliseconds poll_interval {};
+
+  std::chrono::milliseconds frame_interval {};
+
+  // Без кадров прогресса и без ожидания Enter между этапами
+  bool headless {};
+
+  // Этапы считаются в модельном времени без процессов и потоков
+  bool virtual_time {};
+
+  std::uint32_t seed {};
+
+  // Путь журнала событий; пустой — журнал не пишется
+  std::string journal {};
+};
+
 class Arbiter
 {
  public:
-  ~Arbiter() { msgctl(progress_queue, IPC_RMID, nullptr); }
+  explicit Arbiter(const Settings& settings)
+      : number_of_stages { settings.stages },
+        coroutines { settings.coroutines },
+        workers { settings.workers },
+        poll_interval { settings.poll_interval },
+        headless { settings.headless },
+        virtual_time { settings.virtual_time },
+        seed { settings.seed },
+        renderer { settings.frame_interval, settings.headless },
+        board { static_cast<std::size_t>(settings.cars) },
+        cars(settings.cars)
+  {
+    for (int car {}; car < settings.cars; ++car)
+      engines.push_back(stream(seed, car));
+
+    if (!settings.journal.empty())
+      journal = std::make_unique<Journal>(
+          settings.journal, JournalHeader {
+                                .cars = static_cast<std::uint32_t>(settings.cars),
+                                .stages =
+                                    static_cast<std::uint32_t>(settings.stages),
+                                .seed = seed,
+                            });
+  }
 
   void prepare()
   {
-    for (auto i { 0 }; i < cars_number; ++i)
+    if (virtual_time) return;
+
+    if (coroutines)
+    {
+      scheduler = std::make_unique<Scheduler>(workers);
+      return;
+    }
+
+    // Иначе буферы stdio, в том числе журнала, сбросятся еще раз при выходе
+    // каждого дочернего процесса
+    std::fflush(nullptr);
+
+    for (int i {}; i < std::ssize(cars); ++i)
     {
       auto const process { fork() };
 
       if (process == 0)
       {
-        if (i == 0) process_group = getpid();
-        setpgid(0, process_group);
-
-        cars.at(i).start(i, progress_queue);
+        cars.at(i).start(i, *board, number_of_stages, engines.at(i));
         std::exit(0);
       }
 
-      processes.at(i) = process;
-
-      if (i == 0) process_group = process;
-      setpgid(process, process_group);
+      processes.push_back(process);
     }
   }
 
@@ -119,76 +268,158 @@ class Arbiter
   {
     for (int stage { 1 }; stage <= number_of_stages; ++stage)
     {
-      current_stage = stage;
-      finish_order_counter = 0;
+      begin_stage(stage);
 
-      for (auto& car : cars)
-        car = {
-          .progress = 0,
-          .order = 0,
-          .points = car.points,
-          .finished = false,
-        };
+      if (virtual_time)
+        simulate_stage(stage, engines,
+                       [this](const JournalEntry& entry) { apply(entry); });
+      else
+        race(stage);
+
+      finish_stage();
+
+      if (stage == number_of_stages || headless || virtual_time) continue;
+
+      std::println("\nНажмите Enter для начала следующего этапа...");
+      std::cin.ignore();
+    }
+
+    display_results();
 
-      std::println("Подготовка этапа {}", stage);
-      sleep(1);
+    for (auto const& process : processes) waitpid(process, nullptr, 0);
+  }
 
-      kill(-process_group, SIGUSR1);
+  // Проигрывает записанный журнал через тот же подсчет очков и вывод
+  void replay(JournalReader& reader)
+  {
+    int stage {};
+
+    while (const auto entry { reader.next() })
+    {
+      if (entry->car >= cars.size())
+        throw std::runtime_error("Journal entry refers to an unknown car");
 
-      unsigned int finished_count {};
-      while (finished_count < cars.size())
+      if (entry->stage != stage)
       {
-        ProgressMessage message {};
+        if (stage != 0) finish_stage();
 
-        while (msgrcv(progress_queue, &message, sizeof(message) - sizeof(long),
-                      0, IPC_NOWAIT) > 0)
-        {
-          auto& car { cars.at(message.id) };
+        stage = entry->stage;
+        begin_stage(stage);
+      }
 
-          car.progress = message.progress;
+      apply(*entry);
+    }
 
-          if (message.finished && !car.finished)
-          {
-            car.finished = true;
-            car.order = ++finish_order_counter;
-            car.points += car.order;
-          }
-        }
+    if (stage != 0) finish_stage();
 
-        finished_count = std::ranges::count_if(cars, &Car::finished);
+    display_results();
+  }
 
-        display_progress();
+ private:
+  void begin_stage(int stage)
+  {
+    current_stage = stage;
+    board->reset();
+    renderer.reset();
+
+    for (auto& car : cars)
+      car = {
+        .progress = 0,
+        .order = 0,
+        .points = car.points,
+        .finished = false,
+      };
+
+    std::println("Подготовка этапа {}", stage);
+  }
 
-        usleep(200000);
+  void race(int stage)
+  {
+    sleep(1);
+
+    board->open(stage);
+    const auto opened { std::chrono::steady_clock::now() };
+
+    if (scheduler)
+      for (int i {}; i < std::ssize(cars); ++i)
+      {
+        auto& worker { scheduler->worker(i) };
+        worker.spawn(Car::drive(i, stage, *board, worker, engines[i]));
       }
 
-      display_points();
+    std::size_t finished_count {};
+    while (finished_count < cars.size())
+    {
+      const auto tick { static_cast<std::uint32_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - opened)
+              .count()) };
 
-      if (stage == number_of_stages)
+      // Один проход по табло вместо вычитывания очереди сообщений
+      for (std::uint32_t index {}; index < cars.size(); ++index)
       {
-        std::println("Гонка завершена");
-        continue;
+        const auto state { board->slots()[index].load() };
+        const auto& car { cars[index] };
+
+        if (state.progress != car.progress || (state.order && !car.finished))
+          apply({
+              .tick = tick,
+              .car = index,
+              .order = static_cast<std::uint32_t>(state.order),
+              .stage = static_cast<std::uint16_t>(stage),
+              .progress = static_cast<std::uint16_t>(state.progress),
+          });
       }
 
-      std::println("\nНажмите Enter для начала следующего этапа...");
-      std::cin.ignore();
+      finished_count = std::ranges::count_if(cars, &Car::finished);
+
+      if (renderer.due()) display_progress();
 
-      kill(-process_group, SIGUSR2);
+      std::this_thread::sleep_for(poll_interval);
     }
+  }
 
-    display_results();
+  // Единственное место, где меняется состояние машин: живая гонка, модель и
+  // воспроизведение журнала дают одинаковые очки
+  void apply(const JournalEntry& entry)
+  {
+    auto& car { cars[entry.car] };
 
-    for (auto const& process : processes) waitpid(process, nullptr, 0);
+    car.progress = entry.progress;
+
+    if (entry.order != 0 && !car.finished)
+    {
+      car.finished = true;
+      car.order = static_cast<int>(entry.order);
+      car.points += car.order;
+    }
+
+    if (journal) journal->append(entry);
   }
 
- private:
-  void display_progress() const
+  void finish_stage()
+  {
+    display_progress();
+
+    display_points();
+
+    if (!virtual_time) display_skew();
+
+    if (current_stage == number_of_stages) std::println("Гонка завершена");
+  }
+
+  void display_progress()
   {
-    std::print("\033[2J\033[1;1H");
-    std::println("Прогресс этапа {}:", current_stage);
+    if (headless) return;
+
+    frame.resize(cars.size() + 1);
+    frame[0] = std::format("Прогресс этапа {}:", current_stage);
 
     for (int i {}; auto const& car : cars)
     {
+      auto& line { frame[++i] };
+      line.clear();
+
       std::string bar(track_length, '.');
 
       int pos { (car.progress * track_length) / finish_line };
@@ -197,21 +428,22 @@ class Arbiter
 
       if (pos < track_length) bar.at(pos) = '>';
 
-      std::print("Машина {} : [{}] {} / {}", (++i), bar, car.progress,
-                 finish_line);
+      std::format_to(std::back_inserter(line), "Машина {} : [{}] {} / {}", i,
+                     bar, car.progress, finish_line);
 
       if (car.finished)
-        std::println(" (Финишировала с местом: {})", car.order);
-      else
-        std::println();
+        std::format_to(std::back_inserter(line),
+                       " (Финишировала с местом: {})", car.order);
     }
+
+    renderer.draw(frame);
   }
 
   void display_points() const
   {
     std::println("\nРезультаты этапа:", current_stage);
 
-    std::array<Car const*, cars_number> orders {};
+    std::vector<Car const*> orders(cars.size());
 
     for (auto [ordered_car, car] : std::ranges::zip_view { orders, cars })
       ordered_car = &car;
@@ -220,14 +452,35 @@ class Arbiter
 
     for (int i {}; auto order : orders)
       std::println("Место {}: Машина {} (Очки: {})", ++i,
-                   std::distance(cars.begin(), order) + 1, order->points);
+                   std::distance(cars.data(), order) + 1, order->points);
+  }
+
+  // Распределение задержки старта относительно открытия этапа
+  void display_skew()
+  {
+    std::vector<std::int64_t> skews {};
+
+    for (auto const& slot : board->slots()) skews.push_back(slot.start_skew());
+
+    std::ranges::sort(skews);
+
+    const auto at { [&](double fraction) {
+      const auto index { static_cast<std::size_t>(
+          fraction * static_cast<double>(skews.size() - 1)) };
+      return static_cast<double>(skews[index]) / 1000;
+    } };
+
+    std::println(
+        "Разброс старта, мкс: минимум {:.1f}, медиана {:.1f}, p99 {:.1f}, "
+        "максимум {:.1f}",
+        at(0), at(0.5), at(0.99), at(1));
   }
 
   void display_results() const
   {
-    std::println("\nИтоговые результаты:");
+    std::println("\nИтоговые результаты (зерно {}):", seed);
 
-    std::array<Car const*, cars_number> scores {};
+    std::vector<Car const*> scores(cars.size());
 
     for (auto [score, car] : std::ranges::zip_view { scores, cars })
       score = &car;
@@ -239,19 +492,158 @@ class Arbiter
                    std::distance(cars.data(), car) + 1, car->points);
   }
 
-  std::array<pid_t, cars_number> processes {};
-  pid_t process_group {};
+  int number_of_stages {};
+  bool coroutines {};
+  unsigned workers {};
+  std::chrono::milliseconds poll_interval {};
+  bool headless {};
+  bool virtual_time {};
+  std::uint32_t seed {};
+
+  Renderer renderer;
+  std::vector<std::string> frame {};
+
+  std::vector<pid_t> processes {};
+
+  SharedBoard board;
 
-  int progress_queue { msgget(IPC_PRIVATE, IPC_CREAT | 0666) };
+  // Объявлен после табло, чтобы потоки остановились раньше его разрушения
+  std::unique_ptr<Scheduler> scheduler {};
 
   int current_stage {};
-  int finish_order_counter {};
-  std::array<Car, cars_number> cars {};
+  std::vector<Car> cars {};
+  std::vector<Engine> engines {};
+
+  std::unique_ptr<Journal> journal {};
 };
 
-int main()
+// Прогоняет count турниров в модельном времени с зернами tournament_seed
+// и печатает их скорость и долю побед каждой машины; победа при равенстве
+// очков делится поровну
+void tournaments(int cars, int stages, int count, std::uint32_t seed)
+{
+  std::vector<Engine> engines(cars);
+  std::vector<int> points(cars);
+  std::vector<double> wins(cars);
+
+  const auto started { std::chrono::steady_clock::now() };
+
+  for (int tournament {}; tournament < count; ++tournament)
+  {
+    for (int car {}; car < cars; ++car)
+      engines[car] = stream(tournament_seed(seed, tournament), car);
+
+    std::ranges::fill(points, 0);
+
+    for (int stage { 1 }; stage <= stages; ++stage)
+      simulate_stage(stage, engines, [&](const JournalEntry& entry) {
+        points[entry.car] += static_cast<int>(entry.order);
+      });
+
+    const auto best { std::ranges::min(points) };
+    const auto winners { std::ranges::count(points, best) };
+
+    for (int car {}; car < cars; ++car)
+      if (points[car] == best) wins[car] += 1.0 / static_cast<double>(winners);
+  }
+
+  const std::chrono::duration<double> spent {
+    std::chrono::steady_clock::now() - started
+  };
+
+  std::println("Турниров: {}, зерно: {}, {:.0f} турниров/с", count, seed,
+               count / spent.count());
+
+  for (int car {}; car < cars; ++car)
+    std::println("Доля побед машины {}: {:.4f}", car + 1,
+                 wins[car] / count);
+}
+
+int main(int argc, char** argv)
 {
-  Arbiter arbiter {};
+  const std::vector<std::string_view> options(argv + 1, argv + argc);
+
+  const auto option { [&](std::string_view name) {
+    return std::ranges::find(options, name) != options.end();
+  } };
+
+  const auto option_text { [&](std::string_view name) {
+    auto it { std::ranges::find(options, name) };
+
+    if (it == options.end() || ++it == options.end())
+      return std::optional<std::string> {};
+
+    return std::optional { std::string { *it } };
+  } };
+
+  const auto option_value { [&](std::string_view name, auto fallback) {
+    const auto text { option_text(name) };
+
+    if (!text) return fallback;
+
+    return static_cast<decltype(fallback)>(std::stoll(*text));
+  } };
+
+  const auto frame_interval { std::chrono::milliseconds(
+      1000 / std::max(option_value("--fps", 5), 1)) };
+
+  if (const auto path { option_text("--replay") })
+  {
+    JournalReader reader { *path };
+
+    Arbiter arbiter { {
+        .cars = static_cast<int>(reader.header.cars),
+        .stages = static_cast<int>(reader.header.stages),
+        .frame_interval = frame_interval,
+        .headless = option("--headless"),
+        .virtual_time = true,
+        .seed = reader.header.seed,
+    } };
+    arbiter.replay(reader);
+    return 0;
+  }
+
+  const auto cars { option_value("--cars", 5) };
+  const auto stages { option_value("--stages", 3) };
+
+  if (cars < 1 || stages < 1)
+    throw std::runtime_error("Car and stage counts must be positive");
+
+  const auto seed { option_value("--seed",
+                                 std::uint32_t { std::random_device {}() }) };
+
+  if (option("--tournaments"))
+  {
+    tournaments(cars, stages, option_value("--tournaments", 1000), seed);
+    return 0;
+  }
+
+  // Процесс на машину — режим по умолчанию, пул потоков включается только
+  // явным --coroutines
+  const auto coroutines { option("--coroutines") };
+
+  if (option("--workers") && !coroutines)
+    throw std::runtime_error("--workers requires --coroutines");
+
+  const auto workers { option_value(
+      "--workers", static_cast<int>(std::max(
+                       1u, std::thread::hardware_concurrency()))) };
+
+  if (workers < 1) throw std::runtime_error("--workers must be at least 1");
+
+  Arbiter arbiter { {
+      .cars = cars,
+      .stages = stages,
+      .coroutines = coroutines,
+      .workers = static_cast<unsigned>(workers),
+      .poll_interval =
+          std::chrono::milliseconds(option_value("--poll-ms", 50)),
+      .frame_interval = frame_interval,
+      .headless = option("--headless"),
+      .virtual_time = option("--virtual-time"),
+      .seed = seed,
+      .journal = option_text("--journal").value_or(""),
+  } };
   arbiter.prepare();
   arbiter.start();
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <format>
+#include <iterator>
+#include <span>
+#include <string>
+#include <vector>
+
+// Терминальный вывод кадрами: хранит предыдущий кадр и для каждой
+// изменившейся строки выводит только хвост, начиная с первой отличающейся
+// ячейки. Весь кадр уходит одним write. В режиме headless ничего не рисует.
+class Renderer
+{
+ public:
+  Renderer(std::chrono::milliseconds frame_interval, bool headless)
+      : frame_interval { frame_interval }, headless { headless }
+  {
+  }
+
+  [[nodiscard]] bool due() const
+  {
+    return !headless &&
+           std::chrono::steady_clock::now() - drawn >= frame_interval;
+  }
+
+  // Следующий кадр будет нарисован заново на очищенном экране
+  void reset() { previous.clear(); }
+
+  void draw(std::span<const std::string> lines)
+  {
+    if (headless) return;
+
+    // Текст, выведенный через stdio, должен оказаться раньше кадра
+    std::fflush(stdout);
+
+    output.clear();
+    auto const it { std::back_inserter(output) };
+
+    if (previous.empty()) output += "\033[2J";
+
+    for (std::size_t row {}; row < lines.size(); ++row)
+    {
+      const auto& line { lines[row] };
+      const auto* old { row < previous.size() ? &previous[row] : nullptr };
+
+      if (old && *old == line) continue;
+
+      std::size_t prefix {};
+
+      if (old)
+      {
+        prefix = static_cast<std::size_t>(
+            std::ranges::mismatch(line, *old).in1 - line.begin());
+
+        // Не разрезать многобайтовый символ UTF-8
+        while (prefix > 0 && (line[prefix] & 0xC0) == 0x80) --prefix;
+      }
+
+      std::format_to(it, "\033[{};{}H", row + 1, columns(line, prefix) + 1);
+      output.append(line, prefix);
+      output += "\033[K";
+    }
+
+    for (auto row { lines.size() }; row < previous.size(); ++row)
+      std::format_to(it, "\033[{};1H\033[K", row + 1);
+
+    drawn = std::chrono::steady_clock::now();
+
+    if (output.empty()) return;
+
+    std::format_to(it, "\033[{};1H", lines.size() + 1);
+
+    for (std::size_t written {}; written < output.size();)
+    {
+      const auto result { ::write(STDOUT_FILENO, output.data() + written,
+                                  output.size() - written) };
+      if (result <= 0) break;
+      written += static_cast<std::size_t>(result);
+    }
+
+    previous.assign(lines.begin(), lines.end());
+  }
+
+ private:
+  // Ширина префикса в ячейках: байты продолжения UTF-8 не занимают места
+  [[nodiscard]] static std::size_t columns(const std::string& line,
+                                           std::size_t bytes)
+  {
+    return static_cast<std::size_t>(
+        std::count_if(line.begin(), line.begin() + bytes,
+                      [](char byte) { return (byte & 0xC0) != 0x80; }));
+  }
+
+  std::chrono::milliseconds frame_interval {};
+
+  bool headless {};
+
+  std::chrono::steady_clock::time_point drawn {};
+
+  std::vector<std::string> previous {};
+
+  std::string output {};
+};
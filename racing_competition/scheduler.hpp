@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Корутина машины: создается приостановленной и запускается планировщиком,
+// кадр освобождается сам по завершении
+struct Drive
+{
+  struct promise_type
+  {
+    Drive get_return_object()
+    {
+      return { std::coroutine_handle<promise_type>::from_promise(*this) };
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    std::suspend_never final_suspend() noexcept { return {}; }
+
+    void return_void() {}
+
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  std::coroutine_handle<> handle {};
+};
+
+// Хешированное колесо таймеров с шагом в миллисекунду: постановка и
+// срабатывание — O(1), задержки длиннее оборота колеса дожидаются своего
+// оборота в той же ячейке. Колесо знает число взведенных таймеров, чтобы
+// поток мог спать до ближайшего из них, а не просыпаться каждый тик.
+class TimerWheel
+{
+ public:
+  static constexpr std::size_t slots { 1024 };
+
+  void schedule(std::coroutine_handle<> handle,
+                std::chrono::milliseconds delay)
+  {
+    const auto deadline { current + std::max<std::int64_t>(delay.count(), 1) };
+
+    wheel[static_cast<std::size_t>(deadline) % slots].push_back(
+        { handle, deadline });
+    ++armed;
+  }
+
+  // Продвигает колесо до тика until, возобновляя созревшие корутины
+  void advance(std::int64_t until)
+  {
+    std::vector<Timer> due {};
+
+    while (current < until)
+    {
+      // Пустое колесо перематывается сразу
+      if (armed == 0)
+      {
+        current = until;
+        break;
+      }
+
+      ++current;
+
+      due.swap(wheel[static_cast<std::size_t>(current) % slots]);
+
+      for (auto const& timer : due)
+        if (timer.deadline <= current)
+        {
+          --armed;
+          timer.handle.resume();
+        }
+        else
+          wheel[static_cast<std::size_t>(current) % slots].push_back(timer);
+
+      due.clear();
+    }
+  }
+
+  [[nodiscard]] std::int64_t now() const { return current; }
+
+  // Тик ближайшего таймера; пустое колесо — nullopt. Ячейки просматриваются
+  // вперед от текущей, поэтому поиск стоит столько же тиков, сколько
+  // потом проспит поток.
+  [[nodiscard]] std::optional<std::int64_t> next() const
+  {
+    if (armed == 0) return std::nullopt;
+
+    for (auto tick { current + 1 };
+         tick <= current + static_cast<std::int64_t>(slots); ++tick)
+      for (auto const& timer : wheel[static_cast<std::size_t>(tick) % slots])
+        if (timer.deadline == tick) return tick;
+
+    // Все таймеры дальше одного оборота
+    auto earliest { std::numeric_limits<std::int64_t>::max() };
+
+    for (auto const& slot : wheel)
+      for (auto const& timer : slot)
+        earliest = std::min(earliest, timer.deadline);
+
+    return earliest;
+  }
+
+ private:
+  struct Timer
+  {
+    std::coroutine_handle<> handle {};
+    std::int64_t deadline {};
+  };
+
+  std::array<std::vector<Timer>, slots> wheel {};
+
+  std::int64_t current {};
+
+  std::size_t armed {};
+};
+
+// Поток с собственным колесом: корутина остается на своем потоке до конца,
+// поэтому колесо не требует синхронизации. Общий только входящий список
+// новых корутин.
+class Worker
+{
+ public:
+  Worker() = default;
+
+  Worker(const Worker&) = delete;
+  Worker& operator=(const Worker&) = delete;
+
+  void spawn(Drive drive)
+  {
+    {
+      const std::lock_guard lock { mutex };
+      inbox.push_back(drive.handle);
+    }
+
+    wake.notify_one();
+  }
+
+  [[nodiscard]] auto sleep(std::chrono::milliseconds delay)
+  {
+    struct Sleep
+    {
+      TimerWheel& wheel;
+      std::chrono::milliseconds delay;
+
+      bool await_ready() const noexcept { return false; }
+
+      void await_suspend(std::coroutine_handle<> handle) const
+      {
+        wheel.schedule(handle, delay);
+      }
+
+      void await_resume() const noexcept {}
+    };
+
+    return Sleep { wheel, delay };
+  }
+
+ private:
+  static constexpr auto tick { std::chrono::milliseconds(1) };
+
+  void run(std::stop_token token)
+  {
+    const auto epoch { std::chrono::steady_clock::now() };
+    std::vector<std::coroutine_handle<>> started {};
+
+    while (!token.stop_requested())
+    {
+      // Колесо догоняет часы до запуска новых корутин, иначе их первые
+      // задержки отсчитывались бы от тика, на котором поток уснул
+      wheel.advance(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - epoch)
+                        .count());
+
+      {
+        const std::lock_guard lock { mutex };
+        started.swap(inbox);
+      }
+
+      for (auto const handle : started) handle.resume();
+      started.clear();
+
+      // Поток спит до ближайшего таймера, а без таймеров — пока не придет
+      // новая корутина или запрос остановки
+      std::unique_lock lock { mutex };
+      const auto arrived { [this] { return !inbox.empty(); } };
+
+      if (const auto deadline { wheel.next() })
+        wake.wait_until(lock, token, epoch + tick * *deadline, arrived);
+      else
+        wake.wait(lock, token, arrived);
+    }
+  }
+
+  std::mutex mutex {};
+
+  std::vector<std::coroutine_handle<>> inbox {};
+
+  std::condition_variable_any wake {};
+
+  TimerWheel wheel {};
+
+  std::jthread thread { [this](std::stop_token token) { run(token); } };
+};
+
+// Небольшой пул потоков, между которыми корутины машин распределяются по
+// номеру машины
+class Scheduler
+{
+ public:
+  explicit Scheduler(unsigned workers)
+  {
+    for (unsigned index {}; index < std::max(workers, 1u); ++index)
+      pool.push_back(std::make_unique<Worker>());
+  }
+
+  [[nodiscard]] Worker& worker(std::size_t car)
+  {
+    return *pool[car % pool.size()];
+  }
+
+ private:
+  std::vector<std::unique_ptr<Worker>> pool {};
+};
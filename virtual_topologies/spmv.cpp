@@ -0,0 +1,321 @@
+#include <mpi.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../mpi_basics/matrix.hpp"
+
+// Распределенное умножение разреженной матрицы на вектор y = A * x,
+// повторяемое --iterations раз, как в итерационном решателе. Матрица —
+// пятиточечный оператор Лапласа на сетке --size x --size, строки и
+// элементы x разложены по рангам блоками. Каждый ранг получает только те
+// чужие элементы x, на которые ссылаются его строки, и только от их
+// владельцев: план обмена строится один раз, обмен идет по графовой
+// топологии через MPI_Neighbor_alltoallv.
+
+namespace
+{
+// Строки ранга в формате CSR
+struct Csr
+{
+  std::vector<int> offsets { 0 };
+  std::vector<int> columns {};
+  std::vector<double> values {};
+};
+
+// Строки first..first + rows оператора Лапласа на сетке side x side
+Csr laplacian(int side, int first, int rows)
+{
+  Csr A {};
+
+  const auto add { [&](int column, double value) {
+    A.columns.push_back(column);
+    A.values.push_back(value);
+  } };
+
+  for (int row { first }; row < first + rows; ++row)
+  {
+    const auto x { row % side }, y { row / side };
+
+    if (y > 0) add(row - side, -1.0);
+    if (x > 0) add(row - 1, -1.0);
+    add(row, 4.0);
+    if (x + 1 < side) add(row + 1, -1.0);
+    if (y + 1 < side) add(row + side, -1.0);
+
+    A.offsets.push_back(static_cast<int>(A.columns.size()));
+  }
+
+  return A;
+}
+
+std::vector<int> displacements(const std::vector<int>& counts)
+{
+  std::vector<int> result(counts.size());
+  std::exclusive_scan(counts.begin(), counts.end(), result.begin(), 0);
+
+  return result;
+}
+
+// План обмена ореолом. Локальный x — свои rows элементов, за ними чужие
+// (ореол) по возрастанию глобального индекса; столбцы A переводятся в эти
+// локальные индексы. Соседи графовой топологии — только ранги, с которыми
+// есть общие элементы x.
+class Halo
+{
+ public:
+  Halo(Csr& A, int n, int first, int rows) : rows { rows }
+  {
+    int size {};
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    const auto own { [&](int column) {
+      return column >= first && column < first + rows;
+    } };
+
+    // При блочном разбиении чужие столбцы по возрастанию уже сгруппированы
+    // по владельцам
+    std::vector<int> ghosts {};
+    for (const auto column : A.columns)
+      if (!own(column)) ghosts.push_back(column);
+
+    std::ranges::sort(ghosts);
+    const auto [unique_end, end] { std::ranges::unique(ghosts) };
+    ghosts.erase(unique_end, end);
+
+    std::vector<int> requested(size), offered(size);
+    for (const auto column : ghosts)
+      ++requested[matrix::block_owner(n, size, column)];
+
+    // Кто у кого что берет, выясняется один раз при построении плана
+    MPI_Alltoall(requested.data(), 1, MPI_INT, offered.data(), 1, MPI_INT,
+                 MPI_COMM_WORLD);
+
+    std::vector<int> wanted(std::reduce(offered.begin(), offered.end()));
+    MPI_Alltoallv(ghosts.data(), requested.data(),
+                  displacements(requested).data(), MPI_INT, wanted.data(),
+                  offered.data(), displacements(offered).data(), MPI_INT,
+                  MPI_COMM_WORLD);
+
+    for (int other {}; other < size; ++other)
+    {
+      if (requested[other] > 0)
+      {
+        sources.push_back(other);
+        receive_counts.push_back(requested[other]);
+      }
+
+      if (offered[other] > 0)
+      {
+        destinations.push_back(other);
+        send_counts.push_back(offered[other]);
+      }
+    }
+
+    receive_displacements = displacements(receive_counts);
+    send_displacements = displacements(send_counts);
+
+    for (const auto column : wanted) send_indices.push_back(column - first);
+    send.resize(send_indices.size());
+
+    ghost_count = static_cast<int>(ghosts.size());
+
+    const auto ghost { [&](int column) {
+      return static_cast<int>(std::ranges::lower_bound(ghosts, column) -
+                              ghosts.begin());
+    } };
+
+    for (auto& column : A.columns)
+      column = own(column) ? column - first : rows + ghost(column);
+
+    MPI_Dist_graph_create_adjacent(
+        MPI_COMM_WORLD, sources.size(), sources.data(), MPI_UNWEIGHTED,
+        destinations.size(), destinations.data(), MPI_UNWEIGHTED,
+        MPI_INFO_NULL, false, &graph);
+  }
+
+  Halo(const Halo&) = delete;
+  Halo& operator=(const Halo&) = delete;
+
+  ~Halo() { MPI_Comm_free(&graph); }
+
+  // Начинает обмен: свои элементы для соседей упаковываются подряд, чужие
+  // принимаются прямо в x за своими
+  MPI_Request start(std::vector<double>& x)
+  {
+    for (std::size_t i {}; i < send_indices.size(); ++i)
+      send[i] = x[send_indices[i]];
+
+    MPI_Request request {};
+    MPI_Ineighbor_alltoallv(send.data(), send_counts.data(),
+                            send_displacements.data(), MPI_DOUBLE,
+                            x.data() + rows, receive_counts.data(),
+                            receive_displacements.data(), MPI_DOUBLE, graph,
+                            &request);
+
+    return request;
+  }
+
+  [[nodiscard]] std::size_t sent() const { return send_indices.size(); }
+
+  [[nodiscard]] int neighbours() const
+  {
+    return static_cast<int>(std::max(sources.size(), destinations.size()));
+  }
+
+  int rows {}, ghost_count {};
+
+ private:
+  MPI_Comm graph {};
+
+  std::vector<int> sources {}, destinations {};
+  std::vector<int> send_counts {}, send_displacements {};
+  std::vector<int> receive_counts {}, receive_displacements {};
+
+  std::vector<int> send_indices {};
+  std::vector<double> send {};
+};
+
+void multiply(const Csr& A, const std::vector<double>& x,
+              std::vector<double>& y, const std::vector<int>& rows)
+{
+  for (const auto row : rows)
+  {
+    double sum {};
+
+    for (auto i { A.offsets[row] }; i < A.offsets[row + 1]; ++i)
+      sum += A.values[i] * x[A.columns[i]];
+
+    y[row] = sum;
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+
+  int size {};
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  int rank {};
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  const std::vector<std::string_view> options(argv + 1, argv + argc);
+
+  const auto option_value { [&](std::string_view name, int fallback) {
+    auto it { std::ranges::find(options, name) };
+
+    if (it == options.end() || ++it == options.end()) return fallback;
+
+    return std::stoi(std::string { *it });
+  } };
+
+  const auto side { std::max(option_value("--size", 1024), 1) };
+  const auto iterations { std::max(option_value("--iterations", 100), 1) };
+
+  const auto n { side * side };
+  const auto first { matrix::block_offset(n, size, rank) },
+      rows { matrix::block_size(n, size, rank) };
+
+  {
+    auto A { laplacian(side, first, rows) };
+    const auto global_columns { A.columns };
+
+    Halo halo { A, n, first, rows };
+
+    // Строки без чужих столбцов считаются, пока идет обмен
+    std::vector<int> inner {}, boundary {};
+    for (int row {}; row < rows; ++row)
+    {
+      const auto columns { std::span { A.columns }.subspan(
+          A.offsets[row], A.offsets[row + 1] - A.offsets[row]) };
+
+      (std::ranges::all_of(columns, [&](int column) { return column < rows; })
+           ? inner
+           : boundary)
+          .push_back(row);
+    }
+
+    // Значения x — небольшие целые, поэтому y проверяется точно
+    const auto value { [](int index) {
+      return static_cast<double>(index % 7 + 1);
+    } };
+
+    std::vector<double> x(rows + halo.ghost_count), y(rows);
+    for (int row {}; row < rows; ++row) x[row] = value(first + row);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    const auto started { MPI_Wtime() };
+
+    for (int iteration {}; iteration < iterations; ++iteration)
+    {
+      auto request { halo.start(x) };
+
+      multiply(A, x, y, inner);
+
+      MPI_Wait(&request, MPI_STATUS_IGNORE);
+
+      multiply(A, x, y, boundary);
+    }
+
+    const auto elapsed { MPI_Wtime() - started };
+
+    // Проверка по исходным глобальным столбцам, без обмена
+    auto verified { true };
+    for (int row {}; row < rows; ++row)
+    {
+      double expected {};
+
+      for (auto i { A.offsets[row] }; i < A.offsets[row + 1]; ++i)
+        expected += A.values[i] * value(global_columns[i]);
+
+      verified = verified && expected == y[row];
+    }
+
+    // Ненулевые элементы и отправляемые за итерацию элементы x
+    const std::array local { static_cast<std::int64_t>(A.values.size()),
+                             static_cast<std::int64_t>(halo.sent()) };
+    std::array<std::int64_t, 2> totals {};
+    MPI_Reduce(local.data(), totals.data(), local.size(), MPI_INT64_T, MPI_SUM,
+               0, MPI_COMM_WORLD);
+
+    double slowest {};
+    MPI_Reduce(&elapsed, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    int neighbours {};
+    const auto own_neighbours { halo.neighbours() };
+    MPI_Reduce(&own_neighbours, &neighbours, 1, MPI_INT, MPI_MAX, 0,
+               MPI_COMM_WORLD);
+
+    MPI_Allreduce(MPI_IN_PLACE, &verified, 1, MPI_CXX_BOOL, MPI_LAND,
+                  MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+      const auto [nonzeros, exchanged] { totals };
+      const auto bytes { exchanged *
+                         static_cast<std::int64_t>(sizeof(double)) };
+
+      std::println("Сетка {}x{}: строк {}, ненулевых {}, рангов {}, соседей "
+                   "до {}",
+                   side, side, n, nonzeros, size, neighbours);
+      std::println("SpMV: {} итераций за {:.3f} c, {:.2f} GFLOP/s", iterations,
+                   slowest, 2.0 * nonzeros * iterations / slowest / 1e9);
+      std::println("Обмен: {} байт за итерацию, всего {:.2f} МБ, {:.2f} ГБ/с",
+                   bytes, 1.0 * bytes * iterations / 1e6,
+                   1.0 * bytes * iterations / slowest / 1e9);
+      std::println("Проверка: {}", verified ? "пройдена" : "ошибка");
+    }
+  }
+
+  MPI_Finalize();
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <print>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../mpi_basics/matrix_file.hpp"
+
+// Произведение вектора 1 x size на матрицу size x size на одномерной решетке
+// из size рангов: ранг i держит столбец i, элементы вектора идут по решетке
+// от ранга 0. linear и ring отличаются только топологией решетки.
+namespace vector_product
+{
+// Столбец ранга и вектор, который целиком есть только на ранге 0
+template <matrix::Number T>
+struct Inputs
+{
+  std::vector<T> column {}, vector {};
+};
+
+// Передает элементы вектора по решетке communicator и возвращает
+// произведение вектора на столбец ранга
+template <matrix::Number T>
+T pass(MPI_Comm communicator, const Inputs<T>& inputs)
+{
+  const auto element { matrix::mpi_type<T>() };
+
+  int size {};
+  MPI_Comm_size(communicator, &size);
+
+  int rank {};
+  MPI_Comm_rank(communicator, &rank);
+
+  int previous_rank {}, next_rank {};
+  MPI_Cart_shift(communicator, 0, 1, &previous_rank, &next_rank);
+
+  T result {};
+
+  for (int i {}; i < size; ++i)
+  {
+    T value {};
+
+    rank == 0 ? value = inputs.vector[i]
+              : MPI_Recv(&value, 1, element, previous_rank, 0, communicator,
+                         MPI_STATUS_IGNORE);
+
+    result += inputs.column[i] * value;
+
+    // В кольце последний ранг не возвращает элемент рангу 0
+    if (next_rank > 0)
+      MPI_Send(&value, 1, element, next_rank, 0, communicator);
+  }
+
+  return result;
+}
+
+// Собирает результаты рангов на ранге 0
+template <matrix::Number T>
+std::vector<T> gather(MPI_Comm communicator, T result)
+{
+  const auto element { matrix::mpi_type<T>() };
+
+  int size {};
+  MPI_Comm_size(communicator, &size);
+
+  std::vector<T> results(size);
+  MPI_Gather(&result, 1, element, results.data(), 1, element, 0,
+             communicator);
+
+  return results;
+}
+
+// Запускает MPI, разбирает параметры, готовит входы в типе --type и
+// печатает результаты, которые multiply(inputs) вернула на ранге 0
+template <class Multiply>
+void run(int argc, char** argv, Multiply&& multiply)
+{
+  using namespace std::views;
+  using std::ranges::to;
+
+  MPI_Init(&argc, &argv);
+
+  int size {};
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  int rank {};
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  const matrix::Options options { argc, argv };
+
+  // Матрица size x size и вектор 1 x size из файлов --matrix и --vector;
+  // столбец матрицы каждый ранг читает сам
+  const auto matrix_path { options.text("--matrix") },
+      vector_path { options.text("--vector") };
+
+  if (!matrix_path.empty() &&
+      matrix::shape(matrix_path, MPI_COMM_WORLD) != std::pair { size, size })
+    throw std::runtime_error("Matrix must be size x size: " + matrix_path);
+
+  const auto print { options.has("--print") };
+
+  // Тип элементов: float, double, int или int64
+  const auto type { options.text("--type").empty() ? "int"
+                                                   : options.text("--type") };
+
+  matrix::dispatch(type, [&]<class T>() {
+    const auto element { matrix::mpi_type<T>() };
+
+    // 0, 1, 2, ... в типе T
+    const auto values { [](int count) {
+      return iota(0) | take(count) |
+             transform([](int value) { return static_cast<T>(value); }) |
+             to<std::vector<T>>();
+    } };
+
+    Inputs<T> inputs { std::vector<T>(size), std::vector<T>(size) };
+
+    // Целая матрица есть только на ранге 0 и только для рассылки
+    // сгенерированных столбцов или отладочного вывода
+    std::vector<T> matrix {};
+
+    if (matrix_path.empty())
+    {
+      if (rank == 0) matrix = values(size * size);
+    }
+    else
+    {
+      inputs.column = matrix::read<T>(matrix_path, { size, 1, 0, rank },
+                                      MPI_COMM_WORLD);
+
+      if (print)
+        matrix = matrix::read<T>(
+            matrix_path, rank == 0 ? matrix::Tile { size, size, 0, 0 }
+                                   : matrix::Tile { 0, 0, 0, 0 },
+            MPI_COMM_WORLD);
+    }
+
+    if (vector_path.empty())
+    {
+      if (rank == 0) inputs.vector = values(size);
+    }
+    else
+      inputs.vector = matrix::read<T>(
+          vector_path,
+          rank == 0 ? matrix::Tile { 1, size, 0, 0 }
+                    : matrix::Tile { 0, 0, 0, 0 },
+          MPI_COMM_WORLD);
+
+    if (rank == 0 && print)
+    {
+      std::println("Исходная матрица:");
+      for (auto const& row : matrix | chunk(size))
+      {
+        for (auto const& value : row) std::print("{} ", value);
+        std::println();
+      }
+
+      std::println("Исходный вектор:");
+      for (auto const& value : inputs.vector) std::print("{} ", value);
+      std::println();
+    }
+
+    // Столбцы уходят прямо из строчной матрицы, без транспонированной копии
+    if (matrix_path.empty())
+    {
+      const auto column_type { matrix::Datatype::column(size, size,
+                                                        element) };
+
+      MPI_Scatter(matrix.data(), 1, column_type, inputs.column.data(),
+                  inputs.column.size(), element, 0, MPI_COMM_WORLD);
+    }
+
+    const auto results { multiply(inputs) };
+
+    if (rank == 0)
+    {
+      std::print("Результат: ");
+      for (auto const& result : results) std::print("{} ", result);
+      std::println();
+    }
+  });
+
+  MPI_Finalize();
+}
+}  // namespace vector_product